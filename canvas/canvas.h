@@ -3,6 +3,7 @@
 
 //#include "../output/outputDispatcher.h"
 #include "../output/outputManager.h"
+#include "../pageBuffer/PixelBatch.h"
 
 /** \mainpage A Somewhat Flexible Display Driver Framework
 So you have this new display and you don't want to come up with all the drawing functions, buffering and what-not yet again?
@@ -55,6 +56,7 @@ class Canvas
     // Frontend types
     typedef typename Frontend::color_t color_t;
     typedef Point<Frontend> point_t;
+    typedef Bbx<Frontend> bbx_t;
 
     /** \brief Import display type from \ref OutputDispatcher **/
     typedef typename outputDispatcher_t::display_t display_t;
@@ -70,6 +72,40 @@ class Canvas
     {
     }
 
+    /** \brief Construct a Canvas for a display whose dimensions are chosen at runtime, i.e. with sizing::runtime
+      in \ref pageBuffer_traits. The page buffer and the output's bookkeeping are taken from an allocator.
+      \param display the display to draw on
+      \param width display width
+      \param height display height
+      \param pages number of pages
+      \param maxPixelsPerChunk maximum number of pixels per chunk
+      \param allocator the allocator, see \ref Arena. storageSize() tells how much it must provide.
+      \param alignment alignment of the storage, a power of two
+    **/
+    template <typename Allocator>
+    Canvas(display_t& display, typename display_t::coordinate_t width, typename display_t::coordinate_t height,
+           size_t pages, size_t maxPixelsPerChunk, Allocator& allocator, size_t alignment = buffer_alignment)
+      : outputDispatcher_(display, width, height, pages, maxPixelsPerChunk, allocator, alignment)
+    {
+    }
+
+    /** \brief number of bytes an allocator must provide for the runtime constructor
+      \see Canvas(display_t&, coordinate_t, coordinate_t, size_t, size_t, Allocator&, size_t)
+    **/
+    static size_t storageSize(typename display_t::coordinate_t width, typename display_t::coordinate_t height,
+                              size_t pages, size_t maxPixelsPerChunk, size_t alignment = buffer_alignment)
+    {
+      return outputDispatcher_t::storageSize(width, height, pages, maxPixelsPerChunk, alignment);
+    }
+
+    /** \brief false if the runtime constructor's dimensions were invalid or its allocator couldn't provide
+      the storage, see OutputManager::valid()
+    **/
+    bool valid() const
+    {
+      return outputDispatcher_.valid();
+    }
+
     void beginFrame()
     {
       outputDevice().beginFrame();
@@ -82,6 +118,18 @@ class Canvas
       outputDispatcher_.update();
     }
 
+    /** \brief give the canvas a slice of CPU time, see OutputManager::update(uint32_t, bool)
+      \tparam Clock a class with <tt>static uint32_t now()</tt>
+      \param budget time budget in the clock's unit
+      \param stopAtPage return when a page was started, so that the application can draw into it
+      \return the state the output reached
+    **/
+    template <typename Clock>
+    update_state update(uint32_t budget, bool stopAtPage = true)
+    {
+      return outputDispatcher_.template update<Clock>(budget, stopAtPage);
+    }
+
     /** \brief get the display this canvas draws on
       \return reference to the display this canvas draws on
     **/
@@ -103,6 +151,32 @@ class Canvas
       return outputDispatcher_.outputDevice();
     }
 
+    /** \brief get the output dispatcher, e.g. to inspect its chunk filter or chunk policy
+      \return reference to the output dispatcher
+    **/
+    outputDispatcher_t& outputDispatcher()
+    {
+      return outputDispatcher_;
+    }
+
+    const outputDispatcher_t& outputDispatcher() const
+    {
+      return outputDispatcher_;
+    }
+
+    /** \brief the output's tracer, e.g. to query a \ref stats::Collector or export a \ref trace::Recorder
+      \return reference to the tracer selected as trace_t in \ref output_traits
+    **/
+    typename outputDispatcher_t::trace_t& tracer()
+    {
+      return outputDispatcher_.tracer();
+    }
+
+    const typename outputDispatcher_t::trace_t& tracer() const
+    {
+      return outputDispatcher_.tracer();
+    }
+
     /** \brief draw a pixel at the specified point, with the specified color.
      * The pixel will only be drawn if it is within the current bounding box.
      * The color will be cast (if possible) to the canvas' color_t.
@@ -115,6 +189,68 @@ class Canvas
       return outputDevice().drawPixel(p, c);
     }
 
+    /** \brief fill an area with colors computed by a functor, see also the functors in \ref gradient.h
+     * \param bbx the area to fill. Only its intersection with the current page is evaluated.
+     * \param f called as f(x, y) for every pixel, returns the pixel's color
+    **/
+    template <typename F>
+    void generate(const bbx_t& bbx, F&& f)
+    {
+      outputDevice().generate(typename output_device_t::bbx_t(bbx.p0, bbx.p1), std::forward<F>(f));
+    }
+
+    /** \brief draw a batch of pixels. The batch is bucketed by page on the first call after it was
+     * modified, and only the current page's bucket is drawn.
+     * \param batch the pixels to draw, a \ref PixelBatch
+    **/
+    template <typename Batch>
+    void drawPixels(Batch& batch)
+    {
+      batch.bucket(outputDevice());
+      outputDevice().drawPixels(batch);
+    }
+
+    /** \brief draw a streamed image. Only the rows that intersect the current page are decoded.
+     * \param origin where the image's upper left pixel is drawn
+     * \param img the image, for example an \ref image::RleImage or \ref image::QoiImage
+    **/
+    template <typename Image>
+    void drawImage(const point_t& origin, const Image& img)
+    {
+      outputDevice().drawImage(origin, img);
+    }
+
+    /** \brief combine a packed bitmap with the canvas using a raster operation, see \ref Blit.h
+     * \tparam Op the raster operation, e.g. raster::rop::Or
+     * \param origin where the bitmap's upper left pixel goes
+     * \param bitmap the bitmap
+    **/
+    template <typename Op = raster::rop::Copy>
+    void blit(const point_t& origin, const raster::Bitmap& bitmap)
+    {
+      outputDevice().template blit<Op>(origin, bitmap);
+    }
+
+    /** \brief scroll the content of an area, see OutputManager::scroll(). Unless damage_tracking is enabled
+     * in \ref output_traits and the display scrolls in hardware, the next frame is sent completely.
+     * \param area the area to scroll
+     * \param dx horizontal distance, positive to the right
+     * \param dy vertical distance, positive downwards
+    **/
+    void scroll(const bbx_t& area, int dx, int dy)
+    {
+      outputDispatcher_.scroll(typename output_device_t::bbx_t(area.p0, area.p1), dx, dy);
+    }
+
+    /** \brief mark an area as changed, for frames that only send changed rows (with damage_tracking in
+     * \ref output_traits), see OutputManager::invalidate(const bbx_t&)
+     * \param area the changed area
+    **/
+    void invalidate(const bbx_t& area)
+    {
+      outputDispatcher_.invalidate(typename output_device_t::bbx_t(area.p0, area.p1));
+    }
+
     /** \brief read a pixel at the specified point.
      * \param p pixel location
      * \return Color at the specified point or a default-constructed color_t
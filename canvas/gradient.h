@@ -0,0 +1,108 @@
+#ifndef SFC_GRADIENT_H
+#define SFC_GRADIENT_H
+
+#include <algorithm>
+#include <cstdint>
+
+#include "../color/calibration.h"
+#include "../color/lut.h"
+#include "../color/rgb24.h"
+
+/** \file gradient.h Gradient functors for Canvas::generate()
+
+ * The functors map a pixel position to an RGB24 color using integer arithmetic only. The interpolation
+ * parameter t is a Q16 fixed-point value in [0, 65536], computed with a reciprocal that is prepared
+ * once in the constructor, so there is no division per pixel.
+**/
+
+namespace gradient
+{
+
+/** \brief linear interpolation between two colors
+ * \param t interpolation parameter, Q16 in [0, 65536]
+**/
+inline color::RGB24 lerp(const color::RGB24& c0, const color::RGB24& c1, int32_t t)
+{
+  return color::RGB24(c0.r() + (((c1.r() - c0.r())*t) >> 16),
+                      c0.g() + (((c1.g() - c0.g())*t) >> 16),
+                      c0.b() + (((c1.b() - c0.b())*t) >> 16));
+}
+
+
+/** \brief Generator for sqrt(i/1024) in Q16 **/
+struct SqrtGenerator
+{
+  typedef uint32_t value_type;
+
+  static constexpr value_type value(size_t i)
+  {
+    return (value_type)(color::math::pow(i/1024., 0.5)*65536. + 0.5);
+  }
+};
+
+
+/** \brief Linear gradient between two points. Pixels before the first point have the first color,
+ * pixels after the second point have the second color.
+**/
+class Linear
+{
+  public:
+    Linear(int32_t x0, int32_t y0, const color::RGB24& c0,
+           int32_t x1, int32_t y1, const color::RGB24& c1)
+      : x0_(x0), y0_(y0), dx_(x1 - x0), dy_(y1 - y0), c0_(c0), c1_(c1)
+    {
+      length2_ = (int64_t)dx_*dx_ + (int64_t)dy_*dy_;
+      reciprocal_ = length2_ ? ((int64_t)1 << 32)/length2_ : 0;
+    }
+
+    color::RGB24 operator()(int32_t x, int32_t y) const
+    {
+      int64_t dot = (int64_t)(x - x0_)*dx_ + (int64_t)(y - y0_)*dy_;
+      dot = std::min(length2_, std::max<int64_t>(0, dot));
+      return lerp(c0_, c1_, (dot*reciprocal_) >> 16);
+    }
+
+  private:
+    int32_t x0_, y0_, dx_, dy_;
+    int64_t length2_;
+    int64_t reciprocal_;
+    color::RGB24 c0_, c1_;
+};
+
+
+/** \brief Radial gradient from a center (first color) to a radius (second color). Pixels outside the
+ * radius have the second color.
+ *
+ * The squared distance is scaled to [0, 1024] and mapped to the distance with a compile-time square
+ * root table.
+**/
+class Radial
+{
+  public:
+    typedef color::lut::Table<SqrtGenerator, 1025> sqrt_table;
+
+    Radial(int32_t cx, int32_t cy, uint32_t radius, const color::RGB24& c0, const color::RGB24& c1)
+      : cx_(cx), cy_(cy), c0_(c0), c1_(c1)
+    {
+      radius2_ = (int64_t)radius*radius;
+      reciprocal_ = radius2_ ? ((int64_t)1024 << 32)/radius2_ : 0;
+    }
+
+    color::RGB24 operator()(int32_t x, int32_t y) const
+    {
+      int64_t dx = x - cx_;
+      int64_t dy = y - cy_;
+      int64_t distance2 = std::min(radius2_, dx*dx + dy*dy);
+      return lerp(c0_, c1_, sqrt_table::data[(distance2*reciprocal_) >> 32]);
+    }
+
+  private:
+    int32_t cx_, cy_;
+    int64_t radius2_;
+    int64_t reciprocal_;
+    color::RGB24 c0_, c1_;
+};
+
+} // namespace gradient
+
+#endif // SFC_GRADIENT_H
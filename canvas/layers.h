@@ -0,0 +1,515 @@
+#ifndef SFC_LAYERS_H
+#define SFC_LAYERS_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "../color/colorArray.h"
+#include "../color/grayscale.h"
+#include "../color/rgb24.h"
+#include "../output/pageRenderer.h"
+#include "../pageBuffer/Blit.h"
+
+/** \file layers.h Layers and sprites, composited into each page while it is sent
+
+ * Instead of drawing the whole scene into every page, an application can keep parts of it as retained
+ * layers: raster layers with their own pixels (direct colors in a \ref color::ColorArray, packed if the
+ * colors are small, or palette indices), and sprites, i.e. streamed images or packed bitmaps at a
+ * position. A \ref layer::Compositor keeps the layers ordered by z, and when the output manager begins a
+ * page, it draws the layers that intersect the page into it, from back to front.
+ *
+ * Layers are changed through the compositor, which marks the rows they cover before and after the change
+ * (see OutputManager::invalidate(const bbx_t&)). With damage_tracking enabled in \ref output_traits (which
+ * needs an addressable or vectored display), moving a sprite then only composites and resends the pages
+ * that contain the rows it left and entered:
+ * \code
+ * template <>
+ * struct output_traits<MyDisplay, DefaultFrontend<MyDisplay> >
+ *   : public default_output_traits<MyDisplay, DefaultFrontend<MyDisplay> >
+ * {
+ *   static constexpr bool damage_tracking = true;
+ * };
+ *
+ * typedef Canvas<MyDisplay> canvas_t;
+ * canvas_t canvas(display);
+ * layer::Compositor<canvas_t::outputDispatcher_t> compositor(canvas.outputDispatcher());
+ * layer::ImageSprite<image::RleImage, canvas_t::output_device_t> ship(shipImage, 10, 20, 1);
+ * compositor.add(ship);
+ * ...
+ * compositor.move(ship, x, y);
+ * canvas.update();
+ * \endcode
+ * Whatever the application draws directly is drawn on top of the layers, and must be marked by the
+ * application itself.
+**/
+
+/** \brief Retained layers and sprites, see \ref layers.h **/
+namespace layer
+{
+
+template <typename Manager>
+class Compositor;
+
+
+/** \brief Base class of layers and sprites: a rectangle at a position, with a z-order
+ * \tparam Buffer the page buffer type the layer draws into
+**/
+template <typename Buffer>
+class Layer
+{
+  public:
+    typedef typename Buffer::bbx_t bbx_t;
+    typedef typename Buffer::point_t point_t;
+
+    /** \brief column of the layer's left edge, may be outside the display **/
+    int x() const {return x_;}
+
+    /** \brief row of the layer's top edge, may be outside the display **/
+    int y() const {return y_;}
+
+    size_t width() const {return width_;}
+
+    size_t height() const {return height_;}
+
+    /** \brief layers with a higher z are drawn on top **/
+    int z() const {return z_;}
+
+    bool visible() const {return visible_;}
+
+    /** \brief the area the layer covers on the display, or an invalid box if it is outside **/
+    bbx_t area() const
+    {
+      int left = std::max(x_, 0);
+      int top = std::max(y_, 0);
+      int right = std::min<int>(x_ + (int)width_ - 1, Buffer::width - 1);
+      int bottom = std::min<int>(y_ + (int)height_ - 1, Buffer::height - 1);
+      if ((left > right) || (top > bottom))
+      {
+        return bbx_t();
+      }
+      return bbx_t(point_t(left, top), point_t(right, bottom));
+    }
+
+    /** \brief draw the layer into the buffer's current page
+     * \param buffer the page buffer
+     * \param clip the part of the layer's area in the current page, always valid
+    **/
+    virtual void render(Buffer& buffer, const bbx_t& clip) const = 0;
+
+  protected:
+    Layer(int x, int y, size_t width, size_t height, int z)
+      : x_(x), y_(y), width_(width), height_(height), z_(z), visible_(true), next_(0)
+    {
+    }
+
+    ~Layer()
+    {
+    }
+
+  private:
+    template <typename> friend class Compositor;
+
+    int x_;
+    int y_;
+    size_t width_;
+    size_t height_;
+    int z_;
+    bool visible_;
+    Layer* next_; /**< next layer in the compositor's z-order */
+};
+
+
+/** \brief A raster layer with its own colors, stored in a \ref color::ColorArray (packed if the colors
+ * have less than 8 bits). The layer is opaque.
+ * \tparam Color the color type of the layer's pixels
+ * \tparam Width width in pixels
+ * \tparam Height height in pixels
+ * \tparam Buffer the page buffer type
+**/
+template <typename Color, size_t Width, size_t Height, typename Buffer>
+class ArrayLayer : public Layer<Buffer>
+{
+  public:
+    typedef color::ColorArray<Color, Width*Height> array_type;
+    typedef typename Layer<Buffer>::bbx_t bbx_t;
+
+    ArrayLayer(int x = 0, int y = 0, int z = 0)
+      : Layer<Buffer>(x, y, Width, Height, z), pixels_()
+    {
+    }
+
+    /** \brief set a pixel, in layer coordinates. Mark the change with Compositor::invalidate(). **/
+    void set(size_t x, size_t y, const Color& c)
+    {
+      pixels_[y*Width + x] = c;
+    }
+
+    /** \brief get a pixel, in layer coordinates **/
+    Color get(size_t x, size_t y) const
+    {
+      return pixels_[y*Width + x];
+    }
+
+    /** \brief the pixels, row by row **/
+    array_type& pixels()
+    {
+      return pixels_;
+    }
+
+    const array_type& pixels() const
+    {
+      return pixels_;
+    }
+
+    void render(Buffer& buffer, const bbx_t& clip) const
+    {
+      const int x0 = this->x();
+      const int y0 = this->y();
+      const array_type& pixels = pixels_;
+      buffer.generate(clip,
+                      [&](size_t x, size_t y)
+                      {
+                        return typename Buffer::color_t(Color(pixels[((int)y - y0)*Width + ((int)x - x0)]));
+                      });
+    }
+
+  private:
+    array_type pixels_;
+};
+
+
+/** \brief A raster layer of palette indices. The indices are packed if Bits is less than 8, and one index
+ * may be transparent.
+ * \tparam Bits bits per index
+ * \tparam Width width in pixels
+ * \tparam Height height in pixels
+ * \tparam Buffer the page buffer type
+**/
+template <uint8_t Bits, size_t Width, size_t Height, typename Buffer>
+class IndexedLayer : public Layer<Buffer>
+{
+  public:
+    typedef color::Grayscale<Bits> index_t;
+    typedef color::ColorArray<index_t, Width*Height> array_type;
+    typedef typename Buffer::color_t color_t;
+    typedef typename Layer<Buffer>::bbx_t bbx_t;
+    typedef typename Layer<Buffer>::point_t point_t;
+
+    /** \brief number of palette entries **/
+    static constexpr size_t colors = (size_t)1 << Bits;
+
+    IndexedLayer(int x = 0, int y = 0, int z = 0)
+      : Layer<Buffer>(x, y, Width, Height, z), indices_(), palette_(), transparent_(-1)
+    {
+    }
+
+    /** \brief set a pixel's palette index, in layer coordinates. Mark the change with Compositor::invalidate(). **/
+    void set(size_t x, size_t y, uint8_t index)
+    {
+      indices_[y*Width + x] = index_t(index);
+    }
+
+    /** \brief get a pixel's palette index, in layer coordinates **/
+    uint8_t get(size_t x, size_t y) const
+    {
+      return index(y*Width + x);
+    }
+
+    /** \brief a palette entry. Mark changes with Compositor::invalidate(). **/
+    color_t& palette(size_t index)
+    {
+      return palette_[index];
+    }
+
+    const color_t& palette(size_t index) const
+    {
+      return palette_[index];
+    }
+
+    /** \brief make pixels with this index transparent, or none if it is negative **/
+    void setTransparent(int index)
+    {
+      transparent_ = index;
+    }
+
+    /** \brief draw the layer. Opaque layers fill the clip in buffer order, layers with a transparent index
+     * fill the spans of equal indices in every row and skip the transparent ones.
+    **/
+    void render(Buffer& buffer, const bbx_t& clip) const
+    {
+      const int x0 = this->x();
+      const int y0 = this->y();
+      if (transparent_ < 0)
+      {
+        buffer.generate(clip,
+                        [&](size_t x, size_t y)
+                        {
+                          return palette_[index(((int)y - y0)*Width + ((int)x - x0))];
+                        });
+        return;
+      }
+      for (int y = clip.top(); y <= clip.bottom(); y++)
+      {
+        size_t row = (y - y0)*Width - x0;
+        for (int x = clip.left(); x <= clip.right(); )
+        {
+          uint8_t i = index(row + x);
+          int end = x + 1;
+          while ((end <= clip.right()) && (index(row + end) == i))
+          {
+            end++;
+          }
+          if (i != transparent_)
+          {
+            buffer.fillSpan(point_t(x, y), end - x, palette_[i]);
+          }
+          x = end;
+        }
+      }
+    }
+
+  private:
+    uint8_t index(size_t i) const
+    {
+      const index_t& c = indices_[i];
+      return c.k().read();
+    }
+
+    array_type indices_;
+    std::array<color_t, colors> palette_;
+    int transparent_;
+};
+
+
+/** \brief A sprite that shows a streamed image, see \ref image.h. Only the image rows in the page are decoded.
+ * \tparam Image the image type, e.g. image::RleImage
+ * \tparam Buffer the page buffer type
+**/
+template <typename Image, typename Buffer>
+class ImageSprite : public Layer<Buffer>
+{
+  public:
+    typedef typename Layer<Buffer>::bbx_t bbx_t;
+    typedef typename Layer<Buffer>::point_t point_t;
+
+    /** \brief create a sprite. The image is not copied and must outlive the sprite. **/
+    ImageSprite(const Image& image, int x = 0, int y = 0, int z = 0)
+      : Layer<Buffer>(x, y, image.width(), image.height(), z), image_(image)
+    {
+    }
+
+    void render(Buffer& buffer, const bbx_t& clip) const
+    {
+      const int x0 = this->x();
+      const int y0 = this->y();
+      image_.decode(clip.top() - y0, clip.bottom() - y0,
+                    [&](size_t x, size_t y, size_t length, const color::RGB24& c)
+                    {
+                      int first = std::max<int>(x0 + x, clip.left());
+                      int last = std::min<int>(x0 + x + length - 1, clip.right());
+                      if (first <= last)
+                      {
+                        buffer.fillSpan(point_t(first, y0 + y), last - first + 1, typename Buffer::color_t(c));
+                      }
+                    });
+    }
+
+  private:
+    const Image& image_;
+};
+
+
+/** \brief A sprite that combines a packed bitmap with the page, see \ref raster::Bitmap. The bitmap's mask
+ * makes the sprite's background transparent. Only available for packed frontend colors, and only drawn at
+ * non-negative positions.
+ * \tparam Buffer the page buffer type
+ * \tparam Op the raster operation, see \ref raster::rop
+**/
+template <typename Buffer, typename Op = raster::rop::Copy>
+class BitmapSprite : public Layer<Buffer>
+{
+  public:
+    typedef typename Layer<Buffer>::bbx_t bbx_t;
+    typedef typename Layer<Buffer>::point_t point_t;
+
+    /** \brief create a sprite. The bitmap's data is not copied and must outlive the sprite. **/
+    BitmapSprite(const raster::Bitmap& bitmap, int x = 0, int y = 0, int z = 0)
+      : Layer<Buffer>(x, y, bitmap.width, bitmap.height, z), bitmap_(bitmap)
+    {
+    }
+
+    void render(Buffer& buffer, const bbx_t&) const
+    {
+      if ((this->x() >= 0) && (this->y() >= 0))
+      {
+        buffer.template blit<Op>(point_t(this->x(), this->y()), bitmap_);
+      }
+    }
+
+  private:
+    raster::Bitmap bitmap_;
+};
+
+
+/** \brief Keeps layers in z-order and composites them into every page the output manager sends
+ *
+ * The layers are linked into an intrusive list, so the compositor doesn't allocate. Layers are not owned
+ * and must be removed before they are destroyed.
+ * \tparam Manager the output manager type, e.g. Canvas::outputDispatcher_t
+**/
+template <typename Manager>
+class Compositor : public PageRenderer<typename Manager::buffer_t>
+{
+  public:
+    typedef typename Manager::buffer_t buffer_t;
+    typedef Layer<buffer_t> layer_t;
+    typedef typename buffer_t::bbx_t bbx_t;
+
+    /** \brief create a compositor and install it as the manager's renderer **/
+    Compositor(Manager& manager)
+      : manager_(manager), first_(0)
+    {
+      manager_.setRenderer(this);
+    }
+
+    ~Compositor()
+    {
+      manager_.setRenderer(0);
+    }
+
+    /** \brief add a layer, on top of the layers with the same z **/
+    void add(layer_t& layer)
+    {
+      if (!contains(layer))
+      {
+        link(layer);
+        damage(layer);
+      }
+    }
+
+    void remove(layer_t& layer)
+    {
+      if (unlink(layer))
+      {
+        damage(layer);
+      }
+    }
+
+    /** \brief move a layer, marking the rows it leaves and enters **/
+    void move(layer_t& layer, int x, int y)
+    {
+      if ((layer.x_ == x) && (layer.y_ == y))
+      {
+        return;
+      }
+      invalidate(layer);
+      layer.x_ = x;
+      layer.y_ = y;
+      invalidate(layer);
+    }
+
+    /** \brief change a layer's z-order; it goes on top of the layers with the same z **/
+    void setZ(layer_t& layer, int z)
+    {
+      bool linked = unlink(layer);
+      layer.z_ = z;
+      if (linked)
+      {
+        link(layer);
+        invalidate(layer);
+      }
+    }
+
+    void show(layer_t& layer, bool visible)
+    {
+      if ((layer.visible_ != visible) && contains(layer))
+      {
+        manager_.invalidate(layer.area());
+      }
+      layer.visible_ = visible;
+    }
+
+    /** \brief mark a layer's area as changed, e.g. after its pixels or palette were modified **/
+    void invalidate(const layer_t& layer)
+    {
+      if (layer.visible_ && contains(layer))
+      {
+        damage(layer);
+      }
+    }
+
+    /** \brief draw the visible layers that intersect the current page, from back to front **/
+    void render(buffer_t& buffer)
+    {
+      bbx_t page = buffer.bbx();
+      for (const layer_t* layer = first_; layer; layer = layer->next_)
+      {
+        if (!layer->visible_)
+        {
+          continue;
+        }
+        bbx_t clip = layer->area().intersect(page);
+        if (clip.valid())
+        {
+          layer->render(buffer, clip);
+        }
+      }
+    }
+
+  private:
+    bool contains(const layer_t& layer) const
+    {
+      for (const layer_t* l = first_; l; l = l->next_)
+      {
+        if (l == &layer)
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    /** \brief insert a layer after all layers with a lower or equal z **/
+    void link(layer_t& layer)
+    {
+      layer_t** next = &first_;
+      while (*next && ((*next)->z_ <= layer.z_))
+      {
+        next = &(*next)->next_;
+      }
+      layer.next_ = *next;
+      *next = &layer;
+    }
+
+    /** \return whether the layer was linked **/
+    bool unlink(layer_t& layer)
+    {
+      for (layer_t** next = &first_; *next; next = &(*next)->next_)
+      {
+        if (*next == &layer)
+        {
+          *next = layer.next_;
+          layer.next_ = 0;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void damage(const layer_t& layer)
+    {
+      if (layer.visible_)
+      {
+        manager_.invalidate(layer.area());
+      }
+    }
+
+    Manager& manager_;
+    layer_t* first_; /**< the layer drawn first, i.e. the bottom one */
+};
+
+} // namespace layer
+
+#endif // SFC_LAYERS_H
@@ -0,0 +1,251 @@
+#ifndef SFC_PAGETASK_H
+#define SFC_PAGETASK_H
+
+/** \file pageTask.h Drawing routines as coroutines that are resumed for every page (C++20)
+
+ * With a page buffer, a frame is drawn once per page, clipped to the page. A plain draw routine has to be
+ * re-entrant for that: it runs from the start for every page, and whatever it computed for one page is
+ * gone for the next. A PageTask is a coroutine instead. It draws into the current page and then
+ * <tt>co_await nextPage</tt>; a \ref PageTaskRenderer resumes it when the output manager begins the next
+ * page (see \ref PageRenderer), so locals and intermediate results live across the pages of a frame and
+ * across frames, and drawing and sending interleave without threads:
+ * \code
+ * typedef Canvas<MyDisplay> canvas_t;
+ *
+ * PageTask<canvas_t::output_device_t> draw(canvas_t& canvas)
+ * {
+ *   Scene scene;
+ *   while (true)
+ *   {
+ *     auto pass = co_await nextPage;
+ *     if (pass.newFrame)
+ *     {
+ *       scene.step(); // once per frame, however many pages there are
+ *     }
+ *     scene.draw(canvas, pass.bbx); // only what intersects the page
+ *   }
+ * }
+ *
+ * PageTaskRenderer<canvas_t::outputDispatcher_t> renderer(canvas.outputDispatcher(), draw(canvas));
+ * while (true)
+ * {
+ *   canvas.update();
+ * }
+ * \endcode
+ * A page only begins when the display is ready for it, so the coroutine never waits for the output
+ * itself. Pages that a frame skips (with damage tracking, see OutputManager::invalidate(const bbx_t&)) don't
+ * resume it.
+ *
+ * Only available if the compiler supports coroutines (\c __cpp_impl_coroutine).
+**/
+
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <utility>
+
+#include "../output/pageRenderer.h"
+
+/** \brief the page a \ref PageTask was resumed for
+ * \tparam Buffer the page buffer type
+**/
+template <typename Buffer>
+struct PagePass
+{
+  typename Buffer::bbx_t bbx; /**< area of the page */
+  size_t page; /**< index of the page */
+  bool newFrame; /**< whether this is the first page the task draws in this frame */
+};
+
+
+/** \brief tag awaited by a \ref PageTask to wait for the next page **/
+struct next_page_t
+{
+};
+
+/** \brief <tt>co_await nextPage</tt> suspends a \ref PageTask until the next page begins, and returns its \ref PagePass **/
+inline constexpr next_page_t nextPage{};
+
+
+/** \brief Coroutine type of a drawing routine that is resumed for every page, see \ref pageTask.h
+ * \tparam Buffer the page buffer type, e.g. Canvas::output_device_t
+**/
+template <typename Buffer>
+class PageTask
+{
+  public:
+    struct promise_type;
+    typedef std::coroutine_handle<promise_type> handle_type;
+
+    /** \brief awaiter for nextPage. The page the task was resumed for is returned at once if the task
+     * hasn't awaited it yet, e.g. at the start of the coroutine.
+    **/
+    struct page_awaiter
+    {
+      bool await_ready() const noexcept
+      {
+        return promise.pending;
+      }
+
+      void await_suspend(handle_type) const noexcept
+      {
+      }
+
+      PagePass<Buffer> await_resume() const noexcept
+      {
+        promise.pending = false;
+        return promise.pass;
+      }
+
+      promise_type& promise;
+    };
+
+    struct promise_type
+    {
+      PageTask get_return_object()
+      {
+        return PageTask(handle_type::from_promise(*this));
+      }
+
+      /** \brief the task starts when the first page begins **/
+      std::suspend_always initial_suspend() noexcept
+      {
+        return {};
+      }
+
+      std::suspend_always final_suspend() noexcept
+      {
+        return {};
+      }
+
+      void return_void()
+      {
+      }
+
+      void unhandled_exception()
+      {
+        std::terminate();
+      }
+
+      page_awaiter await_transform(next_page_t)
+      {
+        return page_awaiter{*this};
+      }
+
+      PagePass<Buffer> pass{};
+      bool pending = false; /**< whether pass was not awaited yet */
+    };
+
+    PageTask(PageTask&& other) noexcept
+      : handle_(std::exchange(other.handle_, nullptr))
+    {
+    }
+
+    PageTask& operator=(PageTask&& other) noexcept
+    {
+      if (this != &other)
+      {
+        destroy();
+        handle_ = std::exchange(other.handle_, nullptr);
+      }
+      return *this;
+    }
+
+    PageTask(const PageTask&) = delete;
+    PageTask& operator=(const PageTask&) = delete;
+
+    ~PageTask()
+    {
+      destroy();
+    }
+
+    /** \brief whether the coroutine has returned **/
+    bool done() const
+    {
+      return !handle_ || handle_.done();
+    }
+
+    /** \brief resume the coroutine for a page
+     * \return false if the coroutine has returned
+    **/
+    bool resume(const PagePass<Buffer>& pass)
+    {
+      if (done())
+      {
+        return false;
+      }
+      handle_.promise().pass = pass;
+      handle_.promise().pending = true;
+      handle_.resume();
+      return true;
+    }
+
+  private:
+    explicit PageTask(handle_type handle)
+      : handle_(handle)
+    {
+    }
+
+    void destroy()
+    {
+      if (handle_)
+      {
+        handle_.destroy();
+        handle_ = nullptr;
+      }
+    }
+
+    handle_type handle_;
+};
+
+
+/** \brief Resumes a \ref PageTask whenever an output manager begins a page. It replaces any other
+ * renderer of the manager, e.g. a \ref layer::Compositor.
+ * \tparam Manager the output manager type, e.g. Canvas::outputDispatcher_t
+**/
+template <typename Manager>
+class PageTaskRenderer : public PageRenderer<typename Manager::buffer_t>
+{
+  public:
+    typedef typename Manager::buffer_t buffer_t;
+
+    /** \brief install the renderer for a task **/
+    PageTaskRenderer(Manager& manager, PageTask<buffer_t> task)
+      : manager_(manager), task_(std::move(task)), started_(false), lastFrame_(0)
+    {
+      manager_.setRenderer(this);
+    }
+
+    ~PageTaskRenderer()
+    {
+      manager_.setRenderer(0);
+    }
+
+    /** \brief whether the task has returned **/
+    bool done() const
+    {
+      return task_.done();
+    }
+
+    void render(buffer_t& buffer)
+    {
+      uint32_t frame = manager_.frame();
+      PagePass<buffer_t> pass{buffer.bbx(), buffer.page(), !started_ || (frame != lastFrame_)};
+      started_ = true;
+      lastFrame_ = frame;
+      task_.resume(pass);
+    }
+
+  private:
+    Manager& manager_;
+    PageTask<buffer_t> task_;
+    bool started_;
+    uint32_t lastFrame_; /**< the manager's frame the task was resumed in last, to detect a new frame */
+};
+
+#endif // __cpp_impl_coroutine
+
+#endif // SFC_PAGETASK_H
@@ -0,0 +1,220 @@
+#ifndef SFC_COLOR_CALIBRATION_H
+#define SFC_COLOR_CALIBRATION_H
+
+#include <algorithm>
+#include <cstdint>
+
+#include "convert.h"
+#include "lut.h"
+
+/** \file calibration.h Gamma-correct and calibrated color conversion
+
+ * The plain convert() functions work on gamma-encoded channel values and scale channels by shifting.
+ * A calibrated conversion instead linearizes the source, mixes channels in linear light and re-encodes
+ * the result for the panel's response curve. All three steps are table lookups; the tables are
+ * generated at compile time from a display profile:
+ *
+ * \code
+ * struct MyPanelProfile
+ * {
+ *   static constexpr unsigned int sourceGamma = 2200;  // encoding of frontend colors, x1000
+ *   static constexpr unsigned int displayGamma = 2500; // response of the panel, x1000
+ *   static constexpr unsigned int whiteR = 1000;       // white point gains, x1000 (<= 1000)
+ *   static constexpr unsigned int whiteG = 940;
+ *   static constexpr unsigned int whiteB = 870;
+ * };
+ * \endcode
+ *
+ * A conversion class is selected as \c conversion_t in \ref pageBuffer_traits and is used for every
+ * chunk that is converted for output.
+**/
+
+namespace color
+{
+
+/** \brief constexpr math, just enough to generate lookup tables with C++11 **/
+namespace math
+{
+
+constexpr double LN2 = 0.693147180559945309417;
+
+constexpr double square(double x)
+{
+  return x*x;
+}
+
+/** \brief Taylor series of exp(x) starting at term n, good for |x| <= 0.5 **/
+constexpr double expTaylor(double x, unsigned int n, double term)
+{
+  return (n == 20) ? 0. : term + expTaylor(x, n + 1, term*x/(n + 1));
+}
+
+constexpr double exp(double x)
+{
+  return ((x > 0.5) || (x < -0.5)) ? square(exp(x/2)) : expTaylor(x, 0, 1.);
+}
+
+/** \brief series 2*atanh(z) = ln((1+z)/(1-z)), good for |z| <= 1/3 **/
+constexpr double atanhSeries(double z, double zPower, unsigned int n)
+{
+  return (n == 41) ? 0. : 2*zPower/n + atanhSeries(z, zPower*z*z, n + 2);
+}
+
+/** \brief natural logarithm for x > 0 **/
+constexpr double ln(double x)
+{
+  return (x < 0.5) ? ln(2*x) - LN2
+       : (x >= 1.) ? ln(x/2) + LN2
+       : atanhSeries((x - 1)/(x + 1), (x - 1)/(x + 1), 1);
+}
+
+constexpr double pow(double x, double y)
+{
+  return (x <= 0.) ? 0. : exp(y*ln(x));
+}
+
+} // namespace math
+
+
+/** \brief Generic calibration table generators, parameterized with a display profile **/
+namespace calibration
+{
+
+/** \brief number of bits used for linear light values **/
+static constexpr unsigned int linear_bits = 12;
+
+static constexpr unsigned int linear_max = (1u << linear_bits) - 1;
+
+/** \brief white point gain of a channel (0: red, 1: green, 2: blue, 3: gray/unity), x1000 **/
+template<typename Profile>
+constexpr unsigned int gain(unsigned int channel)
+{
+  return (channel == 0) ? Profile::whiteR
+       : (channel == 1) ? Profile::whiteG
+       : (channel == 2) ? Profile::whiteB
+       : 1000;
+}
+
+/** \brief Generator for the table that maps an 8-bit encoded value to linear light, including the channel's gain **/
+template<typename Profile, unsigned int Channel>
+struct LinearizeGenerator
+{
+  typedef uint16_t value_type;
+
+  static constexpr value_type value(size_t v)
+  {
+    return (value_type)(math::pow(v/255., Profile::sourceGamma/1000.)*gain<Profile>(Channel)/1000.*linear_max + 0.5);
+  }
+};
+
+/** \brief Generator for the table that maps linear light to an 8-bit value encoded for the display **/
+template<typename Profile>
+struct EncodeGenerator
+{
+  typedef uint8_t value_type;
+
+  static constexpr value_type value(size_t l)
+  {
+    return (value_type)(math::pow(l/(double)linear_max, 1000./Profile::displayGamma)*255. + 0.5);
+  }
+};
+
+} // namespace calibration
+
+
+/** \brief A neutral display profile: gamma 2.2 on both ends, no white point correction **/
+struct DefaultProfile
+{
+  static constexpr unsigned int sourceGamma = 2200;
+  static constexpr unsigned int displayGamma = 2200;
+  static constexpr unsigned int whiteR = 1000;
+  static constexpr unsigned int whiteG = 1000;
+  static constexpr unsigned int whiteB = 1000;
+};
+
+
+/** \brief Conversion that uses the convert() functions, i.e. plain shifts on encoded values **/
+struct DirectConversion
+{
+  template<typename To, typename From>
+  static void convert(To& to, const From& from)
+  {
+    color::convert(to, from);
+  }
+
+  /** \brief convert n colors
+   * \param src iterator to the first source color
+   * \param dst iterator to the first target color
+   * \param n number of colors
+  **/
+  template<typename Src, typename Dst>
+  static void copy(Src src, Dst dst, size_t n)
+  {
+    std::copy_n(src, n, dst);
+  }
+};
+
+
+/** \brief Conversion that linearizes, mixes in linear light and re-encodes for the display, using
+ * compile-time tables generated from a display profile.
+ * \tparam Profile the display profile, see \ref calibration.h
+**/
+template<typename Profile>
+struct CalibratedConversion
+{
+  static_assert((Profile::whiteR <= 1000) && (Profile::whiteG <= 1000) && (Profile::whiteB <= 1000),
+                "CalibratedConversion: white point gains must be <= 1000");
+
+  typedef lut::Table<calibration::LinearizeGenerator<Profile, 0>, 256> linear_r;
+  typedef lut::Table<calibration::LinearizeGenerator<Profile, 1>, 256> linear_g;
+  typedef lut::Table<calibration::LinearizeGenerator<Profile, 2>, 256> linear_b;
+  typedef lut::Table<calibration::LinearizeGenerator<Profile, 3>, 256> linear_k;
+  typedef lut::Table<calibration::EncodeGenerator<Profile>, calibration::linear_max + 1> encode;
+
+  template<typename To, typename From>
+  static void convert(RgbBase<To>& to, const RgbBase<From>& from)
+  {
+    to.r().write(encode::data[linear_r::data[from.r().read(channel::left_aligned)]], channel::left_aligned);
+    to.g().write(encode::data[linear_g::data[from.g().read(channel::left_aligned)]], channel::left_aligned);
+    to.b().write(encode::data[linear_b::data[from.b().read(channel::left_aligned)]], channel::left_aligned);
+  }
+
+  /** \brief luminance is mixed in linear light with Rec. 709 weights (54, 183, 19)/256 **/
+  template<uint8_t To, typename From>
+  static void convert(Grayscale<To>& to, const RgbBase<From>& from)
+  {
+    uint32_t y = 54*linear_k::data[from.r().read(channel::left_aligned)]
+               + 183*linear_k::data[from.g().read(channel::left_aligned)]
+               + 19*linear_k::data[from.b().read(channel::left_aligned)];
+    to.k().write(encode::data[y >> 8], channel::left_aligned);
+  }
+
+  template<typename To, uint8_t From>
+  static void convert(RgbBase<To>& to, const Grayscale<From>& from)
+  {
+    uint8_t k = from.k().read(channel::left_aligned);
+    to.r().write(encode::data[linear_r::data[k]], channel::left_aligned);
+    to.g().write(encode::data[linear_g::data[k]], channel::left_aligned);
+    to.b().write(encode::data[linear_b::data[k]], channel::left_aligned);
+  }
+
+  template<uint8_t To, uint8_t From>
+  static void convert(Grayscale<To>& to, const Grayscale<From>& from)
+  {
+    to.k().write(encode::data[linear_k::data[from.k().read(channel::left_aligned)]], channel::left_aligned);
+  }
+
+  template<typename Src, typename Dst>
+  static void copy(Src src, Dst dst, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i, ++src, ++dst)
+    {
+      auto&& to = *dst;
+      convert(to, *src);
+    }
+  }
+};
+
+} // namespace color
+
+#endif // SFC_COLOR_CALIBRATION_H
@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
+#include <type_traits>
 
 #include "../color/colorRepresentation.h"
 
@@ -20,14 +21,35 @@
 namespace color
 {
 
-template <typename Color>
-struct PackedColorArray_traits
+/** \brief Storage word of a \ref PackedColorArray
+ *
+ * Elements are packed starting at the least significant bit of the first word. With bytes, this is the
+ * layout displays expect on any host. Wider words need fewer loads and stores per element and don't alias
+ * other data the way bytes do, and on little-endian hosts their memory layout is exactly the same as that
+ * of bytes. On big-endian hosts, only bytes give the byte-exact layout.
+ * \tparam Word an unsigned integer type
+**/
+template <typename Word>
+struct packed_storage
 {
-  typedef uint8_t storage_type;
+  static_assert(std::is_unsigned<Word>::value, "packed_storage: the storage word must be an unsigned integer type");
+  typedef Word storage_type;
   typedef storage_type value_type;
 };
 
 
+/** \brief Storage of packed colors, bytes by default. Specialize this to choose a wider word, e.g.
+ * \code
+ * template <>
+ * struct PackedColorArray_traits<color::Monochrome> : public packed_storage<uint32_t> {};
+ * \endcode
+**/
+template <typename Color>
+struct PackedColorArray_traits : public packed_storage<uint8_t>
+{
+};
+
+
 /** \brief A packed array of colors that are smaller than the array's underlying storage type.
  *
  * Colors that have a colorRepresentation_traits<Color>::storage_bit_size of less than 8 bits may
@@ -53,7 +75,7 @@ class PackedColorArray
     static_assert(value_bitwidth % Bits == 0, "Cannot pack this : (value_bitwidth % Bits per element) != 0");
 
     /** \brief example: for Bits = 3, arg_mask = 0b111 (right aligned) */
-    static constexpr value_type arg_mask = (1<< Bits)-1;
+    static constexpr value_type arg_mask = (value_type)((1u << Bits) - 1);
 
     /** \brief number of underlying storage elements */
     static constexpr size_t storage_size = (Bits*Elements+(value_bitwidth-1))/value_bitwidth;
@@ -71,6 +93,8 @@ class PackedColorArray
      *         ++---- proxy(data_[0],2) accesses these bits (2..3) when assignment/conversion operators are called
      *                const_proxy only provides read access
      * \endcode
+     * A proxy refers to its storage word and writes it when it is destroyed. A const_proxy holds a copy of
+     * the word, so reading never touches memory again and the word can stay in a register.
      * \tparam isConst whether this is a constant or non-constant version of the proxy class.
      */
 
@@ -103,7 +127,11 @@ class PackedColorArray
          */
         proxyT(storage_type& data, size_t offset);
 
-        storage_type& data_; /**< reference to the underlying storage */
+        typedef typename std::conditional<isConst,
+                                          const storage_base_type,
+                                          storage_base_type&>::type member_type;
+
+        member_type data_; /**< the underlying storage word, or a copy of it for const proxies */
 
         size_t offset_; /**< first bit to access in the underlying storage */
     };
@@ -150,6 +178,9 @@ class PackedColorArray
     /** \brief convenience method to clear the underlying storage */
     void clear();
 
+    /** \brief set all elements to a color, a whole storage element at a time */
+    void fill(const Color& color);
+
     /** \brief element access
      * \param i element index
      */
@@ -163,6 +194,8 @@ class PackedColorArray
 
     /** \brief Random access iterator base class, template for const vs non-const access
      *
+     * The iterator holds a pointer to the current storage word and the bit offset in it, so stepping to
+     * the next element is an add and a shift, and dereferencing needs no index arithmetic.
      * \tparam isConst sets constness if true, and non-constness otherwise.
      */
     template<bool isConst>
@@ -223,8 +256,13 @@ class PackedColorArray
         // More comparison operators
 
       private:
-        storage_type* data_;
-        size_t i_;
+        template <bool> friend class iteratorT;
+
+        /** \brief bit position relative to word_, which may be negative or exceed a word **/
+        void seek(ptrdiff_t bits);
+
+        storage_type* word_; /**< current storage word */
+        size_t offset_; /**< bit offset of the current element in word_ */
     };
 
 
@@ -22,6 +22,20 @@ PackedColorArray<Color, Elements>::clear()
   data_.fill(0);
 }
 
+template<typename Color, size_t Elements>
+void
+PackedColorArray<Color, Elements>::fill(const Color& color)
+{
+  value_type element = 0;
+  proxy(element, 0) = color;
+  value_type pattern = 0;
+  for (size_t offset = 0; offset < value_bitwidth; offset += Bits)
+  {
+    pattern |= element << offset;
+  }
+  data_.fill(pattern);
+}
+
 template<typename Color, size_t Elements>
 typename PackedColorArray<Color, Elements>::proxy
 PackedColorArray<Color, Elements>::operator[](size_t i)
@@ -77,7 +91,7 @@ template <bool isConst>
 typename PackedColorArray<Color, Elements>::template proxyT<isConst>::value_type
 PackedColorArray<Color, Elements>::proxyT<isConst>::read() const
 {
-  return (data_ & (arg_mask << offset_)) >> offset_;
+  return (data_ >> offset_) & arg_mask;
 }
 
 template<typename Color, size_t Elements>
@@ -146,8 +160,19 @@ PackedColorArray<Color, Elements>::const_proxy::const_proxy(const value_type& da
 template<typename Color, size_t Elements>
 template <bool isConst>
 PackedColorArray<Color, Elements>::iteratorT<isConst>::iteratorT(storage_type* data, size_t i)
-  : data_(data), i_(i)
+  : word_(data + (i*Bits)/value_bitwidth), offset_((i*Bits) % value_bitwidth)
+{
+}
+
+template<typename Color, size_t Elements>
+template <bool isConst>
+void
+PackedColorArray<Color, Elements>::iteratorT<isConst>::seek(ptrdiff_t bits)
 {
+  bits += offset_;
+  ptrdiff_t words = (bits >= 0) ? bits/(ptrdiff_t)value_bitwidth : -(((ptrdiff_t)value_bitwidth - 1 - bits)/(ptrdiff_t)value_bitwidth);
+  word_ += words;
+  offset_ = bits - words*(ptrdiff_t)value_bitwidth;
 }
 
 // Input iterator, Forward Iterator
@@ -157,7 +182,9 @@ template <bool isConst>
 typename PackedColorArray<Color, Elements>::template iteratorT<isConst>&
 PackedColorArray<Color, Elements>::iteratorT<isConst>::operator++()
 {
-  i_++;
+  offset_ += Bits;
+  word_ += offset_/value_bitwidth;
+  offset_ %= value_bitwidth;
   return *this;
 }
 
@@ -177,7 +204,7 @@ template <bool b>
 bool
 PackedColorArray<Color, Elements>::iteratorT<isConst>::operator==(const PackedColorArray<Color, Elements>::iteratorT<b>& rhs) const
 {
-  return ((data_ == rhs.data_) && (i_ == rhs.i_));
+  return ((word_ == rhs.word_) && (offset_ == rhs.offset_));
 }
 
 template<typename Color, size_t Elements>
@@ -194,9 +221,7 @@ template <bool isConst>
 typename PackedColorArray<Color, Elements>::template iteratorT<isConst>::value_type
 PackedColorArray<Color, Elements>::iteratorT<isConst>::operator*() const
 {
-  size_t dataIndex = (i_*Bits)/value_bitwidth;
-  uint8_t offset = (i_ * Bits) % value_bitwidth;
-  return value_type(data_[dataIndex], offset);
+  return value_type(*word_, offset_);
 }
 
 // Bidirectional iterator
@@ -206,7 +231,8 @@ template <bool isConst>
 typename PackedColorArray<Color, Elements>::template iteratorT<isConst>&
 PackedColorArray<Color, Elements>::iteratorT<isConst>::operator--()
 {
-  i_--;
+  seek(-(ptrdiff_t)Bits);
+  return *this;
 }
 
 template<typename Color, size_t Elements>
@@ -226,7 +252,7 @@ template <bool isConst>
 typename PackedColorArray<Color, Elements>::template iteratorT<isConst>&
 PackedColorArray<Color, Elements>::iteratorT<isConst>::operator+=(size_t n)
 {
-  i_ += n;
+  seek((ptrdiff_t)(n*Bits));
   return *this;
 }
 
@@ -245,7 +271,7 @@ template <bool isConst>
 typename PackedColorArray<Color, Elements>::template iteratorT<isConst>&
 PackedColorArray<Color, Elements>::iteratorT<isConst>::operator-=(size_t n)
 {
-  i_ -= n;
+  seek(-(ptrdiff_t)(n*Bits));
   return *this;
 }
 
@@ -259,12 +285,12 @@ PackedColorArray<Color, Elements>::iteratorT<isConst>::operator-(size_t n) const
   return result;
 }
 
-// Difference (do I need further comparisons?)
+// Difference
 
 template<typename Color, size_t Elements>
 template <bool isConst>
 typename PackedColorArray<Color, Elements>::template iteratorT<isConst>::difference_type
 PackedColorArray<Color, Elements>::iteratorT<isConst>::operator-(const iteratorT& rhs) const
 {
-  return i_ - rhs.i_;
+  return ((word_ - rhs.word_)*(ptrdiff_t)value_bitwidth + (ptrdiff_t)offset_ - (ptrdiff_t)rhs.offset_)/(ptrdiff_t)Bits;
 }
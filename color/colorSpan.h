@@ -0,0 +1,238 @@
+#ifndef SFC_COLORSPAN_H
+#define SFC_COLORSPAN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "colorArray.h"
+
+/** \file colorSpan.h Color containers with a runtime size and external storage
+
+ * A ColorSpan is the runtime-sized counterpart of a \ref ColorArray: it provides the same element
+ * access, iterators and data() pointer, but views storage that was allocated elsewhere (for example
+ * from an \ref Arena in DMA-capable memory). Like ColorArray, it packs colors that are smaller than a
+ * byte and uses a plain array of colors otherwise.
+**/
+
+namespace color
+{
+
+template <typename Color, bool pack>
+class ColorSpanT;
+
+
+/** \brief ColorSpan for packed colors, using the proxies and iterators of \ref PackedColorArray **/
+template <typename Color>
+class ColorSpanT<Color, true>
+{
+  public:
+    typedef PackedColorArray<Color, 1> packed_type;
+    typedef typename packed_type::value_type value_type;
+    typedef typename packed_type::proxy reference;
+    typedef typename packed_type::const_proxy const_reference;
+    typedef typename packed_type::iterator iterator;
+    typedef typename packed_type::const_iterator const_iterator;
+
+    static constexpr size_t alignment = alignof(value_type);
+
+    /** \brief number of bytes needed to store n colors, in whole storage words **/
+    static size_t bytes(size_t n)
+    {
+      return sizeof(value_type)*((packed_type::Bits*n + packed_type::value_bitwidth - 1)/packed_type::value_bitwidth);
+    }
+
+    ColorSpanT()
+      : data_(0), size_(0)
+    {
+    }
+
+    /** \brief view storage for n colors
+     * \param storage at least bytes(n) bytes
+     * \param n number of colors
+    **/
+    ColorSpanT(void* storage, size_t n)
+      : data_(static_cast<value_type*>(storage)), size_(n)
+    {
+      std::fill_n(data_, bytes(n)/sizeof(value_type), 0);
+    }
+
+    size_t size() const
+    {
+      return size_;
+    }
+
+    value_type* data()
+    {
+      return data_;
+    }
+
+    const value_type* data() const
+    {
+      return data_;
+    }
+
+    reference operator[](size_t i)
+    {
+      return reference(data_[i*packed_type::Bits/packed_type::value_bitwidth], i*packed_type::Bits % packed_type::value_bitwidth);
+    }
+
+    const_reference operator[](size_t i) const
+    {
+      return const_reference(data_[i*packed_type::Bits/packed_type::value_bitwidth], i*packed_type::Bits % packed_type::value_bitwidth);
+    }
+
+    iterator begin()
+    {
+      return iterator(data_, 0);
+    }
+
+    iterator end()
+    {
+      return iterator(data_, size_);
+    }
+
+    const_iterator begin() const
+    {
+      return const_iterator(data_, 0);
+    }
+
+    const_iterator end() const
+    {
+      return const_iterator(data_, size_);
+    }
+
+    void fill(const Color& c)
+    {
+      for (size_t i = 0; i < size_; i++)
+      {
+        (*this)[i] = c;
+      }
+    }
+
+  private:
+    value_type* data_;
+    size_t size_;
+};
+
+
+/** \brief ColorSpan for colors that occupy whole bytes **/
+template <typename Color>
+class ColorSpanT<Color, false>
+{
+  public:
+    typedef Color value_type;
+    typedef Color& reference;
+    typedef const Color& const_reference;
+    typedef Color* iterator;
+    typedef const Color* const_iterator;
+
+    static constexpr size_t alignment = alignof(Color);
+
+    /** \brief number of bytes needed to store n colors **/
+    static size_t bytes(size_t n)
+    {
+      return sizeof(Color)*n;
+    }
+
+    ColorSpanT()
+      : data_(0), size_(0)
+    {
+    }
+
+    /** \brief view storage for n colors, which are default-constructed
+     * \param storage at least bytes(n) bytes, aligned for Color
+     * \param n number of colors
+    **/
+    ColorSpanT(void* storage, size_t n)
+      : data_(static_cast<Color*>(storage)), size_(n)
+    {
+      for (size_t i = 0; i < n; i++)
+      {
+        ::new (static_cast<void*>(data_ + i)) Color;
+      }
+    }
+
+    size_t size() const
+    {
+      return size_;
+    }
+
+    Color* data()
+    {
+      return data_;
+    }
+
+    const Color* data() const
+    {
+      return data_;
+    }
+
+    Color& operator[](size_t i)
+    {
+      return data_[i];
+    }
+
+    const Color& operator[](size_t i) const
+    {
+      return data_[i];
+    }
+
+    iterator begin()
+    {
+      return data_;
+    }
+
+    iterator end()
+    {
+      return data_ + size_;
+    }
+
+    const_iterator begin() const
+    {
+      return data_;
+    }
+
+    const_iterator end() const
+    {
+      return data_ + size_;
+    }
+
+    void fill(const Color& c)
+    {
+      std::fill_n(data_, size_, c);
+    }
+
+  private:
+    Color* data_;
+    size_t size_;
+};
+
+
+/** \brief A runtime-sized view of colors in external storage, see \ref colorSpan.h
+ * \tparam Color the color type
+**/
+template <typename Color>
+class ColorSpan : public ColorSpanT<Color,
+  ((color::colorRepresentation_traits<Color>::storage_bit_size % 8 != 0)
+   && (8*sizeof(typename Color::storage_type) / color::colorRepresentation_traits<Color>::storage_bit_size >= 1))>
+{
+  typedef ColorSpanT<Color,
+    ((color::colorRepresentation_traits<Color>::storage_bit_size % 8 != 0)
+     && (8*sizeof(typename Color::storage_type) / color::colorRepresentation_traits<Color>::storage_bit_size >= 1))> base_type;
+
+  public:
+    ColorSpan()
+    {
+    }
+
+    ColorSpan(void* storage, size_t n)
+      : base_type(storage, n)
+    {
+    }
+};
+
+} // namespace color
+
+#endif // SFC_COLORSPAN_H
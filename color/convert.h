@@ -58,10 +58,15 @@ void convert(RgbBase<To>& to, const Grayscale<From>& from)
 template<uint8_t To, typename From>
 void convert(Grayscale<To>& to, const RgbBase<From>& from)
 {
-  uint16_t k = ((uint16_t)(0.39*256.))*from.r().read(channel::left_aligned)
-             + ((uint16_t)(0.59*256.))*from.g().read(channel::left_aligned)
-             + ((uint16_t)(0.11*256.))*from.b().read(channel::left_aligned);
-  to.k().write(k >> 8);
+  // 0.30, 0.59 and 0.11 in 1/256 units, rounded so that white stays white
+  static constexpr uint16_t wr = 77;
+  static constexpr uint16_t wg = 151;
+  static constexpr uint16_t wb = 28;
+  static_assert(wr + wg + wb == 256, "convert: gray weights must sum up to 256");
+  uint16_t k = wr*from.r().read(channel::left_aligned)
+             + wg*from.g().read(channel::left_aligned)
+             + wb*from.b().read(channel::left_aligned);
+  to.k().write(k >> 8, channel::left_aligned);
 }
 
 } // namespace color
@@ -0,0 +1,84 @@
+#ifndef SFC_COLOR_LUT_H
+#define SFC_COLOR_LUT_H
+
+#include <cstddef>
+
+/** \file lut.h Compile-time lookup tables
+
+ * Color conversion and output stages replace per-pixel arithmetic with table lookups. The tables are
+ * generated by the compiler from a Generator class, so they end up in flash (or .rodata) and cost
+ * nothing at runtime. This only requires C++11 constexpr, so generators must compute a value with a
+ * single return statement.
+**/
+
+namespace color
+{
+
+/** \brief Compile-time lookup table helpers **/
+namespace lut
+{
+
+/** \brief a compile-time sequence of indices (std::index_sequence is C++14) **/
+template<size_t... I>
+struct index_sequence
+{
+};
+
+template<typename A, typename B>
+struct concat_sequence;
+
+template<size_t... A, size_t... B>
+struct concat_sequence<index_sequence<A...>, index_sequence<B...> >
+{
+  typedef index_sequence<A..., (sizeof...(A) + B)...> type;
+};
+
+/** \brief creates index_sequence<0, ..., N-1> with logarithmic instantiation depth, so that large tables
+ * don't hit the compiler's template recursion limit.
+**/
+template<size_t N>
+struct make_index_sequence
+  : public concat_sequence<typename make_index_sequence<N/2>::type,
+                           typename make_index_sequence<N - N/2>::type>
+{
+};
+
+template<>
+struct make_index_sequence<0>
+{
+  typedef index_sequence<> type;
+};
+
+template<>
+struct make_index_sequence<1>
+{
+  typedef index_sequence<0> type;
+};
+
+
+/** \brief A lookup table that is filled at compile time
+ * \tparam Generator class that provides a \c value_type typedef and a
+ *   <tt>static constexpr value_type value(size_t i)</tt> function
+ * \tparam Size the number of table entries
+**/
+template<typename Generator, size_t Size, typename = typename make_index_sequence<Size>::type>
+struct Table;
+
+template<typename Generator, size_t Size, size_t... I>
+struct Table<Generator, Size, index_sequence<I...> >
+{
+  typedef typename Generator::value_type value_type;
+
+  static constexpr size_t size = Size;
+
+  static constexpr value_type data[Size] = {Generator::value(I)...};
+};
+
+template<typename Generator, size_t Size, size_t... I>
+constexpr typename Table<Generator, Size, index_sequence<I...> >::value_type
+Table<Generator, Size, index_sequence<I...> >::data[Size];
+
+} // namespace lut
+} // namespace color
+
+#endif // SFC_COLOR_LUT_H
@@ -0,0 +1,265 @@
+#ifndef SFC_PLANARCOLORARRAY_H
+#define SFC_PLANARCOLORARRAY_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+#include "rgb.h"
+
+/** \file planarColorArray.h Planar (structure of arrays) color containers
+
+ * A \ref ColorArray stores colors one after another, e.g. three bytes per RGB24 pixel. Code that
+ * processes one channel at a time (blending, dithering, gamma or grayscale conversion) then has to
+ * deinterleave on every pass. A PlanarColorArray stores each channel in its own plane of bytes, so such
+ * code can run over contiguous memory, and provides the same proxies and iterators as a
+ * \ref PackedColorArray for everything else. When a chunk is sent, \ref PlanarColorArray::interleave()
+ * writes the colors back in the display's layout or wire format.
+ *
+ * Planar storage is opt-in for page buffers, see \c layout_t in \ref default_pageBuffer_traits.
+**/
+
+namespace color
+{
+
+/** \brief memory layouts of color arrays **/
+namespace layout
+{
+  /** \brief colors are stored one after another, see \ref ColorArray **/
+  struct interleaved {};
+
+
+  /** \brief every channel is stored in its own plane, see \ref PlanarColorArray **/
+  struct planar {};
+}
+
+
+/** \brief An array of RGB colors, stored as three planes of channel values
+ *
+ * Plane 0 holds the red, plane 1 the green and plane 2 the blue channel of every element, one byte per
+ * channel value, right aligned as in the color itself.
+ * \tparam Color the color type, an \ref RgbBase color with at most 8 bits per channel
+ * \tparam Elements the number of elements
+**/
+template<typename Color, size_t Elements>
+class PlanarColorArray
+{
+  public:
+    static_assert(std::is_base_of<RgbBase<Color>, Color>::value, "PlanarColorArray: only RGB colors can be stored in planes");
+
+    typedef Color color_type;
+    typedef uint8_t value_type;
+
+    /** \brief number of planes **/
+    static constexpr size_t planes = 3;
+
+    /** \brief number of underlying storage elements **/
+    static constexpr size_t storage_size = planes*Elements;
+
+    /** \brief Accesses the channel values of one element in all planes. The proxy is a copy of the
+     * color, and proxy writes it back when it is destroyed, just like the proxies of \ref PackedColorArray.
+     * \tparam isConst whether this is a constant or non-constant version of the proxy class.
+    **/
+    template<bool isConst>
+    class proxyT : public Color
+    {
+      public:
+        typedef Color color_type;
+        typedef typename std::conditional<isConst, const value_type, value_type>::type storage_type;
+
+      protected:
+        /** \brief Creates a proxy for the element whose red channel is at data **/
+        proxyT(storage_type* data)
+          : Color(data[0], data[Elements], data[2*Elements]), data_(data)
+        {
+        }
+
+        storage_type* data_; /**< the element's value in the first plane */
+    };
+
+
+    /** \brief See \ref proxyT and \ref const_proxy **/
+    class proxy : public proxyT<false>
+    {
+      public:
+        proxy(value_type* data)
+          : proxyT<false>(data)
+        {
+        }
+
+        template<typename C>
+        proxy& operator=(const C& color)
+        {
+          Color::operator=(Color(color));
+          return *this;
+        }
+
+        proxy& operator=(const proxy& other)
+        {
+          Color::operator=(static_cast<const Color&>(other));
+          return *this;
+        }
+
+        ~proxy()
+        {
+          proxyT<false>::data_[0] = Color::r().read();
+          proxyT<false>::data_[Elements] = Color::g().read();
+          proxyT<false>::data_[2*Elements] = Color::b().read();
+        }
+    };
+
+
+    /** \brief see \ref proxyT and \ref proxy **/
+    class const_proxy : public proxyT<true>
+    {
+      public:
+        const_proxy(const value_type* data)
+          : proxyT<true>(data)
+        {
+        }
+    };
+
+
+    /** \brief reference type to refer to container elements */
+    typedef proxy reference;
+
+
+    /** \brief Random access iterator, template for const vs non-const access
+     * \tparam isConst sets constness if true, and non-constness otherwise.
+    **/
+    template<bool isConst>
+    class iteratorT
+    {
+      public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef typename std::conditional<isConst, const_proxy, proxy>::type value_type;
+        typedef typename std::conditional<isConst, const PlanarColorArray::value_type, PlanarColorArray::value_type>::type storage_type;
+        typedef value_type& reference;
+        typedef value_type* pointer;
+        typedef ptrdiff_t difference_type;
+
+        iteratorT(storage_type* data, size_t i)
+          : data_(data), i_(i)
+        {
+        }
+
+        iteratorT& operator++() {i_++; return *this;}
+
+        iteratorT operator++(int) {iteratorT previous(*this); operator++(); return previous;}
+
+        iteratorT& operator--() {i_--; return *this;}
+
+        iteratorT operator--(int) {iteratorT previous(*this); operator--(); return previous;}
+
+        iteratorT& operator+=(size_t n) {i_ += n; return *this;}
+
+        iteratorT operator+(size_t n) const {iteratorT result(*this); result += n; return result;}
+
+        iteratorT& operator-=(size_t n) {i_ -= n; return *this;}
+
+        iteratorT operator-(size_t n) const {iteratorT result(*this); result -= n; return result;}
+
+        difference_type operator-(const iteratorT& rhs) const {return (difference_type)i_ - (difference_type)rhs.i_;}
+
+        template <bool b>
+        bool operator==(const iteratorT<b>& rhs) const {return (data_ == rhs.data_) && (i_ == rhs.i_);}
+
+        template <bool b>
+        bool operator!=(const iteratorT<b>& rhs) const {return !operator==(rhs);}
+
+        value_type operator*() const
+        {
+          return value_type(data_ + i_);
+        }
+
+      private:
+        template <bool> friend class iteratorT;
+
+        storage_type* data_;
+        size_t i_;
+    };
+
+
+    typedef iteratorT<false> iterator;
+
+    typedef iteratorT<true> const_iterator;
+
+    /** \brief pointer to the underlying storage, the planes one after another **/
+    value_type* data() {return data_.data();}
+
+    /** \brief const pointer to the underlying storage **/
+    const value_type* data() const {return data_.data();}
+
+    /** \brief the channel values of plane p (0: red, 1: green, 2: blue) **/
+    value_type* plane(size_t p) {return data_.data() + p*Elements;}
+
+    /** \brief the const channel values of plane p (0: red, 1: green, 2: blue) **/
+    const value_type* plane(size_t p) const {return data_.data() + p*Elements;}
+
+    size_t size() const {return Elements;}
+
+    /** \brief convenience method to clear the underlying storage **/
+    void clear()
+    {
+      data_.fill(0);
+    }
+
+    /** \brief set all elements to a color, one plane at a time **/
+    void fill(const Color& color)
+    {
+      std::fill_n(plane(0), Elements, color.r().read());
+      std::fill_n(plane(1), Elements, color.g().read());
+      std::fill_n(plane(2), Elements, color.b().read());
+    }
+
+    proxy operator[](size_t i) {return proxy(data_.data() + i);}
+
+    const_proxy operator[](size_t i) const {return const_proxy(data_.data() + i);}
+
+    iterator begin() {return iterator(data_.data(), 0);}
+
+    iterator end() {return iterator(data_.data(), Elements);}
+
+    const_iterator begin() const {return const_iterator(data_.data(), 0);}
+
+    const_iterator end() const {return const_iterator(data_.data(), Elements);}
+
+    /** \brief write n elements, starting at offset, interleaved to an output iterator. The loop reads
+     * the three planes sequentially and builds each color from its channel values, without proxies.
+     * \param offset first element
+     * \param n number of elements
+     * \param out an iterator that accepts colors, e.g. a Color* or a \ref wire::writer, which encodes
+     *        the colors in a display's wire format
+    **/
+    template <typename Out>
+    void interleave(size_t offset, size_t n, Out out) const
+    {
+      const value_type* r = plane(0) + offset;
+      const value_type* g = plane(1) + offset;
+      const value_type* b = plane(2) + offset;
+      for (size_t i = 0; i < n; ++i, ++out)
+      {
+        *out = Color(r[i], g[i], b[i]);
+      }
+    }
+
+    const std::array<value_type, storage_size>& array() const
+    {
+      return data_;
+    }
+
+    std::array<value_type, storage_size>& array()
+    {
+      return data_;
+    }
+
+  private:
+    std::array<value_type, storage_size> data_;
+};
+
+} // namespace color
+
+#endif // SFC_PLANARCOLORARRAY_H
@@ -1,6 +1,8 @@
 #ifndef SFC_BBX_H
 #define SFC_BBX_H
 
+#include <algorithm>
+
 #include "point.h"
 
 template <typename Layer>
@@ -19,11 +21,42 @@ struct Bbx
             && ((p0.y() <= p.y()) && (p.y() <= p1.y())));
   }
 
+  coordinate_t top() const
+  {
+    return std::min(p0.y(), p1.y());
+  }
+
   coordinate_t bottom() const
   {
     return std::max(p0.y(), p1.y());
   }
 
+  coordinate_t left() const
+  {
+    return std::min(p0.x(), p1.x());
+  }
+
+  coordinate_t right() const
+  {
+    return std::max(p0.x(), p1.x());
+  }
+
+  /** \brief a box is valid if it contains at least one point **/
+  bool valid() const
+  {
+    return (p0.x() <= p1.x()) && (p0.y() <= p1.y());
+  }
+
+  /** \brief intersection with another box
+   * \return the overlapping area, or an invalid box if there is none
+  **/
+  Bbx intersect(const Bbx& other) const
+  {
+    Bbx result(point_t(std::max(left(), other.left()), std::max(top(), other.top())),
+               point_t(std::min(right(), other.right()), std::min(bottom(), other.bottom())));
+    return result.valid() ? result : Bbx();
+  }
+
 	point_t p0;
 	point_t p1;
 };
@@ -0,0 +1,181 @@
+#ifndef SFC_IMAGE_H
+#define SFC_IMAGE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../color/rgb24.h"
+
+/** \file image.h Streamed images
+
+ * A streamed image is a compressed bitmap that is decoded straight into the current page of a
+ * \ref PageBuffer, so the decoded image never has to be held in RAM. A row index allows the decoder to
+ * start at the first row that intersects the page and stop after the last one, so every page pass only
+ * decodes the rows it needs.
+ *
+ * Layout of an image (all values little endian):
+ * \code
+ * offset  size  content
+ *      0     4  magic "SFCI"
+ *      4     1  codec id (see image::rle and image::qoi)
+ *      5     1  reserved (0)
+ *      6     2  width
+ *      8     2  height
+ *     10     2  rows per index entry (R)
+ *     12   4*N  row index: N = ceil(height/R) offsets of row R*i, relative to the start of the pixel data
+ *   12+4*N      pixel data
+ * \endcode
+ * Codec state is reset at each indexed row, so decoding may start at any index entry.
+**/
+
+/** \brief Streamed image classes and codecs **/
+namespace image
+{
+
+/** \brief size of the fixed header, in bytes **/
+static constexpr size_t header_size = 12;
+
+inline uint16_t read16(const uint8_t* p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+inline uint32_t read32(const uint8_t* p)
+{
+  return read16(p) | ((uint32_t)read16(p + 2) << 16);
+}
+
+inline void write16(std::vector<uint8_t>& out, uint16_t value)
+{
+  out.push_back(value & 0xFF);
+  out.push_back(value >> 8);
+}
+
+
+/** \brief A streamed image in memory (RAM or flash)
+ * \tparam Codec the codec used for the pixel data, \ref image::rle or \ref image::qoi
+**/
+template <typename Codec>
+class Image
+{
+  public:
+    typedef Codec codec_type;
+
+    /** \brief Create an image from encoded data. The data is not copied and must outlive the image.
+     * \param data pointer to the encoded image, starting with the header
+    **/
+    Image(const uint8_t* data)
+      : data_(data)
+    {
+    }
+
+    /** \brief check the magic and codec id **/
+    bool valid() const
+    {
+      return (data_[0] == 'S') && (data_[1] == 'F') && (data_[2] == 'C') && (data_[3] == 'I')
+          && (data_[4] == Codec::id) && (rowsPerIndex() != 0);
+    }
+
+    uint16_t width() const
+    {
+      return read16(data_ + 6);
+    }
+
+    uint16_t height() const
+    {
+      return read16(data_ + 8);
+    }
+
+    uint16_t rowsPerIndex() const
+    {
+      return read16(data_ + 10);
+    }
+
+    /** \brief decode a range of rows
+     * \param first first row to decode
+     * \param last last row to decode (inclusive)
+     * \param sink called as sink(x, y, length, color) for every decoded span of equally colored pixels
+    **/
+    template <typename Sink>
+    void decode(size_t first, size_t last, Sink&& sink) const
+    {
+      if ((first > last) || (first >= height()))
+      {
+        return;
+      }
+      last = std::min<size_t>(last, height() - 1);
+      size_t entry = first / rowsPerIndex();
+      const uint8_t* pixels = data_ + header_size + 4*((height() + rowsPerIndex() - 1) / rowsPerIndex());
+      const uint8_t* in = pixels + read32(data_ + header_size + 4*entry);
+
+      typename Codec::decoder decoder;
+      for (size_t y = entry*rowsPerIndex(); y <= last; y++)
+      {
+        if ((y % rowsPerIndex()) == 0)
+        {
+          decoder.reset();
+        }
+        if (y < first)
+        {
+          decoder.decodeRow(in, width(), [](size_t, size_t, const color::RGB24&) {});
+        }
+        else
+        {
+          decoder.decodeRow(in, width(),
+                            [&](size_t x, size_t length, const color::RGB24& c)
+                            {
+                              sink(x, y, length, c);
+                            });
+        }
+      }
+    }
+
+  private:
+    const uint8_t* data_;
+};
+
+
+/** \brief Encode an image, typically on the host when building assets
+ * \tparam Codec the codec to use
+ * \param pixels width*height colors, row by row
+ * \param width image width
+ * \param height image height
+ * \param rowsPerIndex number of rows per row index entry. Smaller values allow finer seeking but
+ *   increase the index size and reset the codec state more often.
+ * \return the encoded image
+**/
+template <typename Codec>
+std::vector<uint8_t> encode(const color::RGB24* pixels, uint16_t width, uint16_t height, uint16_t rowsPerIndex)
+{
+  std::vector<uint8_t> out = {'S', 'F', 'C', 'I', Codec::id, 0};
+  write16(out, width);
+  write16(out, height);
+  write16(out, rowsPerIndex);
+  size_t entries = (height + rowsPerIndex - 1) / rowsPerIndex;
+  size_t indexOffset = out.size();
+  out.resize(out.size() + 4*entries);
+
+  std::vector<uint8_t> data;
+  typename Codec::encoder encoder;
+  for (size_t y = 0; y < height; y++)
+  {
+    if ((y % rowsPerIndex) == 0)
+    {
+      uint32_t offset = data.size();
+      for (size_t i = 0; i < 4; i++)
+      {
+        out[indexOffset + 4*(y / rowsPerIndex) + i] = (offset >> (8*i)) & 0xFF;
+      }
+      encoder.reset();
+    }
+    encoder.encodeRow(data, pixels + y*width, width);
+  }
+  out.insert(out.end(), data.begin(), data.end());
+  return out;
+}
+
+} // namespace image
+
+#endif // SFC_IMAGE_H
@@ -0,0 +1,177 @@
+#ifndef SFC_IMAGE_QOI_H
+#define SFC_IMAGE_QOI_H
+
+#include <array>
+
+#include "image.h"
+
+namespace image
+{
+
+/** \brief QOI-style codec for streamed images
+ *
+ * The operations are those of the "Quite OK Image" format without alpha:
+ * - <tt>11111110 r g b</tt>: literal color
+ * - <tt>00iiiiii</tt>: color from the 64-entry index of recently seen colors
+ * - <tt>01rrggbb</tt>: small difference to the previous color (-2..1 per channel)
+ * - <tt>10gggggg rrrrbbbb</tt>: green difference -32..31, red and blue relative to it -8..7
+ * - <tt>11nnnnnn</tt>: repeat the previous color n+1 times (n < 62)
+ *
+ * Runs don't cross the end of a row, and the previous color and the index are reset at every indexed
+ * row (see \ref image.h), so decoding can start at any index entry. Photographic content typically
+ * compresses much better than with \ref rle.
+**/
+struct qoi
+{
+  static constexpr uint8_t id = 2;
+
+  enum : uint8_t
+  {
+    op_index = 0x00,
+    op_diff = 0x40,
+    op_luma = 0x80,
+    op_run = 0xC0,
+    op_rgb = 0xFE,
+    op_mask = 0xC0
+  };
+
+  static uint8_t hash(uint8_t r, uint8_t g, uint8_t b)
+  {
+    return (r*3 + g*5 + b*7 + 255*11) % 64;
+  }
+
+  /** \brief state shared by encoder and decoder **/
+  class state
+  {
+    public:
+      void reset()
+      {
+        index_.fill(0);
+        r_ = 0;
+        g_ = 0;
+        b_ = 0;
+      }
+
+    protected:
+      void set(uint8_t r, uint8_t g, uint8_t b)
+      {
+        r_ = r;
+        g_ = g;
+        b_ = b;
+        uint8_t h = hash(r, g, b);
+        index_[3*h] = r;
+        index_[3*h + 1] = g;
+        index_[3*h + 2] = b;
+      }
+
+      std::array<uint8_t, 3*64> index_;
+      uint8_t r_, g_, b_;
+  };
+
+  class decoder : public state
+  {
+    public:
+      /** \brief decode one row
+       * \param in read position, advanced to the start of the next row
+       * \param width the image width
+       * \param sink called as sink(x, length, color)
+      **/
+      template <typename Sink>
+      void decodeRow(const uint8_t*& in, size_t width, Sink&& sink)
+      {
+        size_t x = 0;
+        while (x < width)
+        {
+          uint8_t op = *in++;
+          size_t n = 1;
+          if (op == op_rgb)
+          {
+            set(in[0], in[1], in[2]);
+            in += 3;
+          }
+          else if ((op & op_mask) == op_index)
+          {
+            set(index_[3*op], index_[3*op + 1], index_[3*op + 2]);
+          }
+          else if ((op & op_mask) == op_diff)
+          {
+            set(r_ + ((op >> 4) & 3) - 2, g_ + ((op >> 2) & 3) - 2, b_ + (op & 3) - 2);
+          }
+          else if ((op & op_mask) == op_luma)
+          {
+            int dg = (op & 0x3F) - 32;
+            uint8_t rb = *in++;
+            set(r_ + dg + (rb >> 4) - 8, g_ + dg, b_ + dg + (rb & 0x0F) - 8);
+          }
+          else
+          {
+            n = (op & 0x3F) + 1;
+          }
+          sink(x, n, color::RGB24(r_, g_, b_));
+          x += n;
+        }
+      }
+  };
+
+  class encoder : public state
+  {
+    public:
+      void encodeRow(std::vector<uint8_t>& out, const color::RGB24* row, size_t width)
+      {
+        size_t run = 0;
+        for (size_t x = 0; x < width; x++)
+        {
+          uint8_t r = row[x].r(), g = row[x].g(), b = row[x].b();
+          if ((r == r_) && (g == g_) && (b == b_))
+          {
+            run++;
+            if (run == 62)
+            {
+              out.push_back(op_run | (run - 1));
+              run = 0;
+            }
+            continue;
+          }
+          if (run)
+          {
+            out.push_back(op_run | (run - 1));
+            run = 0;
+          }
+          uint8_t h = hash(r, g, b);
+          int8_t dr = r - r_, dg = g - g_, db = b - b_;
+          int8_t drg = dr - dg, dbg = db - dg;
+          if ((index_[3*h] == r) && (index_[3*h + 1] == g) && (index_[3*h + 2] == b))
+          {
+            out.push_back(op_index | h);
+          }
+          else if ((dr >= -2) && (dr <= 1) && (dg >= -2) && (dg <= 1) && (db >= -2) && (db <= 1))
+          {
+            out.push_back(op_diff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+          }
+          else if ((dg >= -32) && (dg <= 31) && (drg >= -8) && (drg <= 7) && (dbg >= -8) && (dbg <= 7))
+          {
+            out.push_back(op_luma | (dg + 32));
+            out.push_back(((drg + 8) << 4) | (dbg + 8));
+          }
+          else
+          {
+            out.push_back(op_rgb);
+            out.push_back(r);
+            out.push_back(g);
+            out.push_back(b);
+          }
+          set(r, g, b);
+        }
+        if (run)
+        {
+          out.push_back(op_run | (run - 1));
+        }
+      }
+  };
+};
+
+typedef Image<qoi> QoiImage;
+
+} // namespace image
+
+#endif // SFC_IMAGE_QOI_H
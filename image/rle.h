@@ -0,0 +1,117 @@
+#ifndef SFC_IMAGE_RLE_H
+#define SFC_IMAGE_RLE_H
+
+#include "image.h"
+
+namespace image
+{
+
+/** \brief Run-length codec for streamed images
+ *
+ * Each row is a sequence of packets that never cross the end of a row:
+ * - <tt>1nnnnnnn r g b</tt>: run of n+1 pixels of one color
+ * - <tt>0nnnnnnn (r g b)*(n+1)</tt>: n+1 literal pixels
+ *
+ * Runs are handed to the sink as one span, so flat areas are written with a single
+ * \ref PageBuffer::fillSpan call.
+**/
+struct rle
+{
+  static constexpr uint8_t id = 1;
+
+  class decoder
+  {
+    public:
+      void reset()
+      {
+      }
+
+      /** \brief decode one row
+       * \param in read position, advanced to the start of the next row
+       * \param width the image width
+       * \param sink called as sink(x, length, color)
+      **/
+      template <typename Sink>
+      void decodeRow(const uint8_t*& in, size_t width, Sink&& sink)
+      {
+        size_t x = 0;
+        while (x < width)
+        {
+          uint8_t tag = *in++;
+          size_t n = (tag & 0x7F) + 1;
+          if (tag & 0x80)
+          {
+            sink(x, n, color::RGB24(in[0], in[1], in[2]));
+            in += 3;
+          }
+          else
+          {
+            for (size_t i = 0; i < n; i++, in += 3)
+            {
+              sink(x + i, 1, color::RGB24(in[0], in[1], in[2]));
+            }
+          }
+          x += n;
+        }
+      }
+  };
+
+  class encoder
+  {
+    public:
+      void reset()
+      {
+      }
+
+      void encodeRow(std::vector<uint8_t>& out, const color::RGB24* row, size_t width)
+      {
+        size_t x = 0;
+        while (x < width)
+        {
+          size_t run = 1;
+          while ((x + run < width) && (run < 128) && equal(row[x + run], row[x]))
+          {
+            run++;
+          }
+          if (run > 1)
+          {
+            out.push_back(0x80 | (run - 1));
+            push(out, row[x]);
+            x += run;
+            continue;
+          }
+          size_t literals = 1;
+          while ((x + literals < width) && (literals < 128)
+                 && !((x + literals + 1 < width) && equal(row[x + literals], row[x + literals + 1])))
+          {
+            literals++;
+          }
+          out.push_back(literals - 1);
+          for (size_t i = 0; i < literals; i++)
+          {
+            push(out, row[x + i]);
+          }
+          x += literals;
+        }
+      }
+
+    private:
+      static bool equal(const color::RGB24& a, const color::RGB24& b)
+      {
+        return (a.r() == b.r()) && (a.g() == b.g()) && (a.b() == b.b());
+      }
+
+      static void push(std::vector<uint8_t>& out, const color::RGB24& c)
+      {
+        out.push_back(c.r());
+        out.push_back(c.g());
+        out.push_back(c.b());
+      }
+  };
+};
+
+typedef Image<rle> RleImage;
+
+} // namespace image
+
+#endif // SFC_IMAGE_RLE_H
@@ -0,0 +1,552 @@
+#ifndef SFC_OUTPUT_CAPTURE_H
+#define SFC_OUTPUT_CAPTURE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "../color/colorArray.h"
+#include "../pageBuffer/PageBuffer.h"
+#include "display.h"
+#include "outputManager.h"
+#include "pageRenderer.h"
+
+/** \file capture.h Capture of display traffic, and replay of captures for benchmarks
+
+ * A \ref capture::RecordingDisplay wraps a Display and writes everything that is sent to it, with
+ * timestamps, to a compact binary stream, e.g. a file on a device that shows a performance problem in
+ * the field. A \ref capture::Replay feeds a capture back through an output manager of any configuration,
+ * as fast as the display allows or with the recorded timing, so that optimizations can be measured
+ * against a real workload:
+ * \code
+ * // on the device
+ * std::ofstream file("session.sfcr", std::ios::binary);
+ * typedef capture::RecordingDisplay<MyDisplay, std::ofstream, MicrosClock> recording_t;
+ * recording_t recording(display, file);
+ * Canvas<recording_t> canvas(recording); // all traits of MyDisplay apply
+ *
+ * // in the benchmark
+ * typedef Canvas<BenchDisplay, BenchFrontend> canvas_t; // BenchFrontend::color_t is MyDisplay::color_t
+ * canvas_t canvas(benchDisplay);
+ * capture::Replay<canvas_t::outputDispatcher_t, MicrosClock> replay(canvas.outputDispatcher());
+ * capture::Replay<canvas_t::outputDispatcher_t, MicrosClock>::result r = replay.run(data.data(), data.size());
+ * \endcode
+ * The Display traffic is recorded rather than the Canvas calls, so a capture doesn't depend on the
+ * application's code and replays exactly what was shown. A frame of the replay is a run of writes with
+ * increasing frame offsets: a write that starts before the end of the previous one, or a scroll, begins
+ * a new frame.
+ *
+ * Format, little-endian, with unsigned LEB128 varints (\c v) and zigzag-encoded signed varints (\c s):
+ * \code
+ * header: "SFCR" u8:version u8:flags u8:bitsPerPixel u16:width u16:height   flags bit 0: wire format is not native
+ * write:  'W' v:dt v:pixelOffset v:bytes u8[bytes]                          dt: microseconds since the previous record
+ * scroll: 'S' v:dt v:top v:bottom s:dy
+ * \endcode
+ * Segments of a vectored write are separate write records.
+**/
+
+/** \brief Capture and replay of display traffic, see \ref capture.h **/
+namespace capture
+{
+
+/** \brief format version written to the header **/
+static constexpr uint8_t version = 1;
+
+/** \brief size of the header in bytes **/
+static constexpr size_t headerBytes = 11;
+
+/** \brief record tags **/
+enum tag : uint8_t
+{
+  write = 'W', /**< data written at a pixel offset */
+  scroll = 'S' /**< rows scrolled by the display */
+};
+
+
+/** \brief A Display that forwards everything to another Display and records it
+ *
+ * It has the other display's traits (see display_traits, pageBuffer_traits, output_traits and
+ * PixelMapping), so a Canvas for it is configured like one for the display itself.
+ * \tparam Display the display to record
+ * \tparam Sink a binary stream with <tt>write(const char* data, n)</tt>, e.g. a std::ostream opened in binary mode
+ * \tparam Clock a class with <tt>static uint32_t now()</tt> that returns microseconds, see \ref AdaptiveChunks
+**/
+template <typename Display, typename Sink, typename Clock>
+class RecordingDisplay
+{
+  public:
+    typedef typename Display::color_t color_t;
+    typedef typename Display::coordinate_t coordinate_t;
+    static constexpr coordinate_t width = Display::width;
+    static constexpr coordinate_t height = Display::height;
+
+    /** \brief number of bits per pixel on the wire **/
+    static constexpr size_t wireBits = wire::pixel_bits<typename display_traits<Display>::wire_format_t, color_t>::value;
+
+    /** \brief start a recording; the header is written at once **/
+    RecordingDisplay(Display& display, Sink& sink)
+      : display_(display), sink_(sink), position_(0), last_(Clock::now())
+    {
+      uint8_t header[headerBytes] = {'S', 'F', 'C', 'R', version,
+                                     display_traits<Display>::wire_format_t::identity ? (uint8_t)0 : (uint8_t)1,
+                                     (uint8_t)wireBits,
+                                     (uint8_t)(width & 0xFF), (uint8_t)(width >> 8),
+                                     (uint8_t)(height & 0xFF), (uint8_t)(height >> 8)};
+      put(header, headerBytes);
+    }
+
+    /** \brief the recorded display **/
+    Display& display()
+    {
+      return display_;
+    }
+
+    void update()
+    {
+      display_.update();
+    }
+
+    bool ready()
+    {
+      return display_.ready();
+    }
+
+    void writeChunk(const uint8_t* data, size_t bytes)
+    {
+      record(data, bytes, position_);
+      position_ = (position_ + (8*bytes)/wireBits) % pixelsPerFrame;
+      display_.writeChunk(data, bytes);
+    }
+
+    /** \brief only if the display is addressable **/
+    void seek(size_t pixelOffset)
+    {
+      position_ = pixelOffset;
+      display_.seek(pixelOffset);
+    }
+
+    /** \brief only if the display is vectored **/
+    void writeChunkv(const ChunkSegment* segments, size_t count)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        record(segments[i].data, segments[i].bytes, segments[i].pixelOffset);
+      }
+      display_.writeChunkv(segments, count);
+    }
+
+    /** \brief only if the display is scrollable **/
+    void scroll(coordinate_t top, coordinate_t bottom, int dy)
+    {
+      begin(capture::scroll);
+      varint(top);
+      varint(bottom);
+      varint(((uint32_t)dy << 1) ^ (uint32_t)(dy >> 31));
+      display_.scroll(top, bottom, dy);
+    }
+
+  private:
+    static constexpr size_t pixelsPerFrame = (size_t)width*height;
+
+    void record(const uint8_t* data, size_t bytes, size_t pixelOffset)
+    {
+      begin(capture::write);
+      varint(pixelOffset);
+      varint(bytes);
+      put(data, bytes);
+    }
+
+    /** \brief write a record's tag and timestamp **/
+    void begin(tag t)
+    {
+      uint32_t now = Clock::now();
+      uint8_t byte = t;
+      put(&byte, 1);
+      varint(now - last_);
+      last_ = now;
+    }
+
+    void varint(size_t value)
+    {
+      uint8_t bytes[10];
+      size_t n = 0;
+      do
+      {
+        bytes[n++] = (value & 0x7F) | ((value > 0x7F) ? 0x80 : 0);
+        value >>= 7;
+      } while (value);
+      put(bytes, n);
+    }
+
+    void put(const uint8_t* data, size_t bytes)
+    {
+      sink_.write(reinterpret_cast<const char*>(data), bytes);
+    }
+
+    Display& display_;
+    Sink& sink_;
+    size_t position_; /**< pixel offset in the frame where the display continues writing */
+    uint32_t last_; /**< time of the previous record */
+};
+
+
+/** \brief a record of a capture **/
+struct Record
+{
+  tag type;
+  uint32_t time; /**< microseconds since the start of the capture */
+  size_t pixelOffset; /**< write: offset of the first pixel */
+  size_t bytes; /**< write: number of bytes */
+  const uint8_t* data; /**< write: the data, points into the capture */
+  size_t top; /**< scroll: first row */
+  size_t bottom; /**< scroll: last row */
+  int dy; /**< scroll: distance, positive downwards */
+};
+
+
+/** \brief Reads a capture from memory **/
+class Reader
+{
+  public:
+    /** \param data the capture, including the header
+     * \param size its size in bytes
+    **/
+    Reader(const uint8_t* data, size_t size)
+      : data_(data), size_(size), position_(headerBytes), time_(0)
+    {
+      valid_ = (size >= headerBytes) && (std::memcmp(data, "SFCR", 4) == 0) && (data[4] == version);
+    }
+
+    /** \brief whether the header is valid **/
+    bool valid() const
+    {
+      return valid_;
+    }
+
+    /** \brief whether the display's wire format was its color storage **/
+    bool native() const
+    {
+      return !(data_[5] & 1);
+    }
+
+    size_t bitsPerPixel() const
+    {
+      return data_[6];
+    }
+
+    size_t width() const
+    {
+      return data_[7] | (data_[8] << 8);
+    }
+
+    size_t height() const
+    {
+      return data_[9] | (data_[10] << 8);
+    }
+
+    /** \brief read the next record
+     * \return false at the end of the capture, or if it is truncated or corrupt
+    **/
+    bool next(Record& r)
+    {
+      if (!valid_ || (position_ >= size_))
+      {
+        return false;
+      }
+      size_t start = position_;
+      r.type = (tag)data_[position_++];
+      size_t dt;
+      bool ok = varint(dt);
+      r.time = time_ + (uint32_t)dt;
+      if (ok && (r.type == write))
+      {
+        ok = varint(r.pixelOffset) && varint(r.bytes) && (r.bytes <= size_ - position_);
+        r.data = data_ + position_;
+        position_ += ok ? r.bytes : 0;
+      }
+      else if (ok && (r.type == scroll))
+      {
+        size_t dy;
+        ok = varint(r.top) && varint(r.bottom) && varint(dy);
+        r.dy = (int)(dy >> 1) ^ -(int)(dy & 1);
+      }
+      else
+      {
+        ok = false;
+      }
+      if (!ok)
+      {
+        position_ = start;
+        valid_ = false;
+        return false;
+      }
+      time_ = r.time;
+      return true;
+    }
+
+    /** \brief offset of the next record in the capture **/
+    size_t position() const
+    {
+      return position_;
+    }
+
+    /** \brief continue at a record read before, see position() **/
+    void rewind(size_t position, uint32_t time)
+    {
+      position_ = position;
+      time_ = time;
+    }
+
+  private:
+    bool varint(size_t& value)
+    {
+      value = 0;
+      for (size_t shift = 0; (position_ < size_) && (shift < 8*sizeof(size_t)); shift += 7)
+      {
+        uint8_t byte = data_[position_++];
+        value |= (size_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t position_;
+    uint32_t time_; /**< time of the last record */
+    bool valid_;
+};
+
+
+/** \brief Replays a capture through an output manager
+ *
+ * The replay reconstructs the recorded frames in a frame buffer and is the manager's \ref PageRenderer:
+ * every page the manager sends is drawn from it. The rows a frame changed are marked with
+ * OutputManager::invalidate(const bbx_t&), so managers with damage_tracking (see \ref output_traits) only
+ * send those, like the recorded application did (if it marked its changes).
+ *
+ * The capture must have been recorded with the native wire format, the size and color type of the
+ * manager's display, and frame offsets in row order (pages of rows, a linear pixel mapping). The frame
+ * buffer is a \ref color::ColorArray of the whole display, so this is meant for a host.
+ * \tparam Manager the output manager type, e.g. Canvas::outputDispatcher_t. Its frontend color must be
+ *         the recorded display's color.
+ * \tparam Clock a class with <tt>static uint32_t now()</tt> that returns microseconds, see \ref AdaptiveChunks
+**/
+template <typename Manager, typename Clock>
+class Replay : public PageRenderer<typename Manager::buffer_t>
+{
+  public:
+    typedef typename Manager::buffer_t buffer_t;
+    typedef typename Manager::bbx_t bbx_t;
+    typedef typename buffer_t::point_t point_t;
+    typedef typename buffer_t::color_t color_t;
+    typedef color::ColorArray<color_t, (size_t)buffer_t::width*buffer_t::height> frame_t;
+
+    /** \brief outcome of a replay **/
+    struct result
+    {
+      bool valid; /**< whether the capture matched the display and was read completely */
+      size_t frames; /**< number of frames replayed */
+      uint32_t recorded; /**< microseconds from the first to the last recorded frame */
+      uint32_t elapsed; /**< microseconds the replay took */
+    };
+
+    /** \brief install the replay as the manager's renderer **/
+    Replay(Manager& manager)
+      : manager_(manager), frame_()
+    {
+      manager_.setRenderer(this);
+    }
+
+    ~Replay()
+    {
+      manager_.setRenderer(0);
+    }
+
+    /** \brief replay a capture; returns when its last frame was sent
+     * \param data the capture, see \ref capture.h
+     * \param size its size in bytes
+     * \param realTime start every frame when it was recorded, relative to the first one. Otherwise, the
+     *        frames are sent as fast as the display takes them.
+    **/
+    result run(const uint8_t* data, size_t size, bool realTime = false)
+    {
+      result r = {false, 0, 0, 0};
+      Reader reader(data, size);
+      if (!reader.valid() || !reader.native() || (reader.bitsPerPixel() != bits)
+          || (reader.width() != buffer_t::width) || (reader.height() != buffer_t::height))
+      {
+        return r;
+      }
+      // the first frame is sent completely, whatever the display showed before
+      manager_.invalidate(bbx_t(point_t(0, 0), point_t(buffer_t::width - 1, buffer_t::height - 1)));
+      const uint32_t start = Clock::now();
+      uint32_t first = 0;
+      uint32_t time;
+      int top;
+      int bottom;
+      while (readFrame(reader, time, top, bottom))
+      {
+        if (!r.frames)
+        {
+          first = time;
+        }
+        r.recorded = time - first;
+        while (realTime && ((uint32_t)(Clock::now() - start) < time - first))
+        {
+        }
+        if (top <= bottom)
+        {
+          manager_.invalidate(bbx_t(point_t(0, top), point_t(buffer_t::width - 1, bottom)));
+        }
+        sendFrame();
+        r.frames++;
+      }
+      r.elapsed = Clock::now() - start;
+      r.valid = reader.position() == size;
+      return r;
+    }
+
+    /** \brief the reconstructed frame **/
+    const frame_t& frame() const
+    {
+      return frame_;
+    }
+
+    void render(buffer_t& buffer)
+    {
+      buffer.generate(buffer.bbx(),
+                      [this](size_t x, size_t y)
+                      {
+                        return color_t(frame_[y*buffer_t::width + x]);
+                      });
+    }
+
+  private:
+    static constexpr size_t bits = color::colorRepresentation_traits<color_t>::storage_bit_size;
+    static constexpr size_t frameBytes = (bits*buffer_t::width*buffer_t::height + 7)/8;
+    static constexpr size_t rowBytes = (bits*buffer_t::width)/8;
+
+    /** \brief apply the records of the next frame to the frame buffer
+     * \param time returns the time of the frame's first record
+     * \param top, bottom return the rows the frame changed
+     * \return false if there are no more records
+    **/
+    bool readFrame(Reader& reader, uint32_t& time, int& top, int& bottom)
+    {
+      uint8_t* raw = reinterpret_cast<uint8_t*>(frame_.data());
+      top = buffer_t::height;
+      bottom = -1;
+      size_t end = 0;
+      bool empty = true;
+      Record record;
+      size_t position = reader.position();
+      uint32_t previous = 0;
+      while (reader.next(record))
+      {
+        if (!empty && ((record.type == scroll) || (record.pixelOffset < end)))
+        {
+          // scrolled, or written before the end of the previous write: the next frame
+          reader.rewind(position, previous);
+          break;
+        }
+        if (empty)
+        {
+          time = record.time;
+          empty = false;
+        }
+        if (record.type == write)
+        {
+          size_t offset = (bits*record.pixelOffset)/8;
+          size_t bytes = std::min(record.bytes, (offset < frameBytes) ? frameBytes - offset : 0);
+          std::memcpy(raw + offset, record.data, bytes);
+          end = record.pixelOffset + (8*record.bytes)/bits;
+          rows(record.pixelOffset, end, top, bottom);
+        }
+        else if ((record.type == scroll) && rowBytes && (record.bottom < buffer_t::height) && (record.top <= record.bottom))
+        {
+          int height = record.bottom - record.top + 1;
+          int dy = std::max(-height, std::min(height, record.dy));
+          int dest = std::max<int>(record.top, record.top + dy);
+          int src = std::max<int>(record.top, record.top - dy);
+          std::memmove(raw + dest*rowBytes, raw + src*rowBytes, (height - std::abs(dy))*rowBytes);
+          top = std::min<int>(top, record.top);
+          bottom = std::max<int>(bottom, record.bottom);
+        }
+        position = reader.position();
+        previous = record.time;
+      }
+      return !empty;
+    }
+
+    /** \brief extend a row range by the rows of a pixel range **/
+    static void rows(size_t begin, size_t end, int& top, int& bottom)
+    {
+      if (end > begin)
+      {
+        top = std::min<int>(top, begin/buffer_t::width);
+        bottom = std::min<int>(std::max<int>(bottom, (end - 1)/buffer_t::width), buffer_t::height - 1);
+      }
+    }
+
+    /** \brief drive the manager until it started a frame and sent it **/
+    void sendFrame()
+    {
+      while (manager_.update() != update_frame)
+      {
+      }
+      while (!manager_.frameSent())
+      {
+        manager_.update();
+      }
+    }
+
+    Manager& manager_;
+    frame_t frame_;
+};
+
+} // namespace capture
+
+
+/** \brief a recording display has the capabilities of the display it records **/
+template <typename Display, typename Sink, typename Clock>
+struct display_traits<capture::RecordingDisplay<Display, Sink, Clock> > : public display_traits<Display>
+{
+};
+
+template <typename Display, typename Sink, typename Clock, typename Frontend>
+struct pageBuffer_traits<capture::RecordingDisplay<Display, Sink, Clock>, Frontend> : public pageBuffer_traits<Display, Frontend>
+{
+};
+
+template <typename Display, typename Sink, typename Clock, typename Frontend>
+struct output_traits<capture::RecordingDisplay<Display, Sink, Clock>, Frontend> : public output_traits<Display, Frontend>
+{
+};
+
+template <typename Display, typename Sink, typename Clock>
+struct PixelMapping<capture::RecordingDisplay<Display, Sink, Clock> > : public PixelMapping<Display>
+{
+};
+
+template <typename Display>
+struct DefaultFrontend;
+
+/** \brief with the default frontend, a recording display uses the traits of the recorded display's default frontend **/
+template <typename Display, typename Sink, typename Clock>
+struct pageBuffer_traits<capture::RecordingDisplay<Display, Sink, Clock>, DefaultFrontend<capture::RecordingDisplay<Display, Sink, Clock> > >
+  : public pageBuffer_traits<Display, DefaultFrontend<Display> >
+{
+};
+
+template <typename Display, typename Sink, typename Clock>
+struct output_traits<capture::RecordingDisplay<Display, Sink, Clock>, DefaultFrontend<capture::RecordingDisplay<Display, Sink, Clock> > >
+  : public output_traits<Display, DefaultFrontend<Display> >
+{
+};
+
+#endif // SFC_OUTPUT_CAPTURE_H
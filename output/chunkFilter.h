@@ -0,0 +1,147 @@
+#ifndef SFC_OUTPUT_CHUNKFILTER_H
+#define SFC_OUTPUT_CHUNKFILTER_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "../pageBuffer/Arena.h"
+#include "../pageBuffer/DynamicPageBuffer.h"
+
+/** \file chunkFilter.h Chunk filters decide which chunks an \ref OutputManager actually sends
+
+ * A chunk filter is selected as \c chunk_filter_t in \ref output_traits. Filters that skip chunks
+ * require an addressable display (see \ref display_traits), because the display's write position has
+ * to be moved past the skipped chunks.
+ *
+ * For a \ref DynamicPageBuffer, the number of chunk slots is only known at runtime. The OutputManager
+ * then calls
+ * \code
+ * static size_t storageSize(size_t slots, size_t alignment); // bytes the filter needs from the allocator
+ * template <typename Allocator>
+ * bool allocate(Allocator& allocator, size_t slots, size_t alignment); // false if out of memory
+ * \endcode
+ * before the first frame.
+**/
+
+/** \brief fast non-cryptographic 32-bit hash, processes 4 bytes per step
+ * \param data the bytes to hash
+ * \param bytes number of bytes
+**/
+inline uint32_t chunkHash(const uint8_t* data, size_t bytes)
+{
+  uint32_t h = 0x811C9DC5u ^ (uint32_t)bytes;
+  size_t words = bytes / 4;
+  for (size_t i = 0; i < words; i++)
+  {
+    uint32_t w;
+    std::memcpy(&w, data + 4*i, 4);
+    h = (h ^ w)*0x9E3779B1u;
+    h ^= h >> 15;
+  }
+  for (size_t i = 4*words; i < bytes; i++)
+  {
+    h = (h ^ data[i])*0x01000193u;
+  }
+  return h;
+}
+
+
+/** \brief Default chunk filter: every chunk is sent **/
+struct AllChunks
+{
+  static constexpr bool skips = false;
+
+  static size_t storageSize(size_t, size_t)
+  {
+    return 0;
+  }
+
+  template <typename Allocator>
+  bool allocate(Allocator&, size_t, size_t)
+  {
+    return true;
+  }
+
+  void invalidate()
+  {
+  }
+
+  bool changed(size_t, const uint8_t*, size_t)
+  {
+    return true;
+  }
+};
+
+
+/** \brief Chunk filter that only sends chunks whose content changed since the previous frame
+ *
+ * One hash per chunk slot of a frame is kept, i.e. 4 bytes per maxPixelsPerChunk pixels. Apps that
+ * clear and redraw everything every frame still only transmit the chunks that actually differ. The
+ * first frame after construction or invalidate() is sent completely. With a \ref DynamicPageBuffer, the
+ * hashes are taken from the OutputManager's allocator.
+ * \tparam Display the Display type
+ * \tparam Frontend the Frontend type
+**/
+template <typename Display, typename Frontend>
+class ContentHashFilter
+{
+  public:
+    typedef typename page_buffer<Display, Frontend>::type buffer_t;
+
+    static constexpr bool skips = true;
+
+    /** \brief number of chunk slots per page, runtime_size for a \ref DynamicPageBuffer **/
+    static constexpr size_t chunksPerPage = buffer_t::maxPixelsPerChunk
+      ? (buffer_t::pixelsPerPage + buffer_t::maxPixelsPerChunk - 1)/buffer_t::maxPixelsPerChunk : runtime_size;
+
+    /** \brief number of chunk slots per frame, runtime_size for a \ref DynamicPageBuffer **/
+    static constexpr size_t slots = buffer_t::pages*chunksPerPage;
+
+    ContentHashFilter()
+    {
+      invalidate();
+    }
+
+    /** \brief number of bytes an allocator must provide for a number of chunk slots, including alignment padding **/
+    static size_t storageSize(size_t count, size_t alignment)
+    {
+      return StorageArray<uint32_t, runtime_size>::storageSize(count, alignment)
+        + StorageArray<bool, runtime_size>::storageSize(count, alignment);
+    }
+
+    /** \brief take the hashes for a number of chunk slots from an allocator
+     * \return false if the allocator couldn't provide the storage
+    **/
+    template <typename Allocator>
+    bool allocate(Allocator& allocator, size_t count, size_t alignment)
+    {
+      return hashes_.allocate(allocator, count, alignment) && valid_.allocate(allocator, count, alignment);
+    }
+
+    /** \brief forget all hashes, so that the next frame is sent completely **/
+    void invalidate()
+    {
+      valid_.fill(false);
+    }
+
+    /** \brief check whether a chunk differs from the previous frame, and remember its hash
+     * \param slot the chunk's slot in the frame
+     * \param data the chunk as it would be sent to the display
+     * \param bytes the chunk's size
+    **/
+    bool changed(size_t slot, const uint8_t* data, size_t bytes)
+    {
+      uint32_t h = chunkHash(data, bytes);
+      bool result = !valid_[slot] || (hashes_[slot] != h);
+      hashes_[slot] = h;
+      valid_[slot] = true;
+      return result;
+    }
+
+  private:
+    StorageArray<uint32_t, slots> hashes_;
+    StorageArray<bool, slots> valid_;
+};
+
+#endif // SFC_OUTPUT_CHUNKFILTER_H
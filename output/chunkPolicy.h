@@ -0,0 +1,151 @@
+#ifndef SFC_OUTPUT_CHUNKPOLICY_H
+#define SFC_OUTPUT_CHUNKPOLICY_H
+
+#include <cstddef>
+#include <cstdint>
+
+/** \file chunkPolicy.h Chunk policies decide how many chunks an \ref OutputManager sends per write
+
+ * A chunk of maxPixelsPerChunk pixels (see \ref pageBuffer_traits) stays the unit of conversion and of
+ * the chunk filter, but adjacent chunks can be coalesced into one Display::writeChunk() call. This is
+ * only possible if the chunks point into the page buffer (ColorBuffer::inPlace); with a conversion
+ * stage, the staging array holds one chunk and every chunk is sent on its own.
+ *
+ * A chunk policy is selected as \c chunk_policy_t in \ref output_traits and provides
+ * \code
+ * size_t chunks(size_t chunkBytes); // number of chunks to coalesce into the next write
+ * void begin();                    // called before Display::writeChunk()
+ * void end(size_t bytes);          // called after Display::writeChunk() returned
+ * \endcode
+**/
+
+/** \brief Default chunk policy: one chunk per write **/
+struct FixedChunks
+{
+  size_t chunks(size_t)
+  {
+    return 1;
+  }
+
+  void begin()
+  {
+  }
+
+  void end(size_t)
+  {
+  }
+};
+
+
+/** \brief Chunk policy that adapts the write size to the display's measured cost per write
+ *
+ * The duration of every Display::writeChunk() call is modelled as <tt>overhead + bytes*cost</tt>. Both
+ * are estimated by an exponentially weighted least squares fit over the recent writes, so the policy
+ * follows changes like a different SPI clock. The number of coalesced chunks is then chosen so that the
+ * overhead stays below OverheadPercent of the write, limited to MaxChunks to bound the latency of a
+ * single write.
+ *
+ * Every 16th write alternates between one and MaxChunks chunks, so the fit sees different sizes even
+ * when the chosen size is stable.
+ *
+ * The clock is a class with <tt>static uint32_t now()</tt>, e.g. for Arduino:
+ * \code
+ * struct MicrosClock
+ * {
+ *   static uint32_t now() { return micros(); }
+ * };
+ * \endcode
+ * Note that only the time spent inside writeChunk() is measured. For displays that return immediately
+ * and transfer in the background, that is exactly the per-write overhead, which is still minimized.
+ *
+ * \tparam Clock the clock class
+ * \tparam MaxChunks maximum number of chunks per write
+ * \tparam OverheadPercent acceptable share of the per-write overhead, in percent
+**/
+template <typename Clock, size_t MaxChunks = 8, unsigned OverheadPercent = 10>
+class AdaptiveChunks
+{
+  static_assert((MaxChunks > 0), "AdaptiveChunks: MaxChunks must be at least 1");
+  static_assert((OverheadPercent > 0) && (OverheadPercent < 100), "AdaptiveChunks: OverheadPercent must be in 1..99");
+
+  public:
+    AdaptiveChunks()
+      : chunks_(1),
+      writes_(0),
+      start_(0),
+      w_(0), x_(0), y_(0), xx_(0), xy_(0),
+      overhead_(0), cost_(0)
+    {
+    }
+
+    size_t chunks(size_t chunkBytes)
+    {
+      if ((writes_ % 16) == 15)
+      {
+        return (chunks_ == 1) ? MaxChunks : 1;
+      }
+      if (cost_ <= 0)
+      {
+        chunks_ = (overhead_ > 0) ? MaxChunks : 1;
+      }
+      else
+      {
+        float bytes = overhead_*(100 - OverheadPercent)/(OverheadPercent*cost_);
+        size_t n = (size_t)(bytes/chunkBytes) + 1;
+        chunks_ = (n < MaxChunks) ? n : MaxChunks;
+      }
+      return chunks_;
+    }
+
+    void begin()
+    {
+      start_ = Clock::now();
+    }
+
+    void end(size_t bytes)
+    {
+      float t = (uint32_t)(Clock::now() - start_);
+      float b = bytes;
+      const float decay = 0.9375f;
+      w_ = w_*decay + 1;
+      x_ = x_*decay + b;
+      y_ = y_*decay + t;
+      xx_ = xx_*decay + b*b;
+      xy_ = xy_*decay + b*t;
+      writes_++;
+
+      float d = w_*xx_ - x_*x_;
+      if (d > 1e-3f*w_*xx_) // write sizes vary enough for a fit
+      {
+        cost_ = (w_*xy_ - x_*y_)/d;
+        overhead_ = (y_ - cost_*x_)/w_;
+      }
+      else if (x_ > 0) // all writes had the same size: attribute everything to the payload
+      {
+        cost_ = y_/x_;
+        overhead_ = 0;
+      }
+    }
+
+    /** \brief estimated overhead per write, in clock ticks **/
+    float overhead() const
+    {
+      return overhead_;
+    }
+
+    /** \brief estimated cost per byte, in clock ticks **/
+    float cost() const
+    {
+      return cost_;
+    }
+
+  private:
+    size_t chunks_;
+    uint32_t writes_;
+    uint32_t start_;
+    float w_, x_, y_, xx_, xy_; /**< decayed sums for the fit */
+    float overhead_;
+    float cost_;
+};
+
+#endif // SFC_OUTPUT_CHUNKPOLICY_H
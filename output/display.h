@@ -0,0 +1,86 @@
+#ifndef SFC_OUTPUT_DISPLAY_H
+#define SFC_OUTPUT_DISPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "wireFormat.h"
+
+/** \file display.h Optional capabilities of a Display
+
+ * The minimal Display concept is what a \ref Canvas needs to drive a display through a \ref PageBuffer:
+ * \code
+ * struct MyDisplay
+ * {
+ *   typedef color::RGB565 color_t;
+ *   typedef uint16_t coordinate_t;
+ *   static constexpr coordinate_t width = 320;
+ *   static constexpr coordinate_t height = 240;
+ *   void update();
+ *   bool ready();
+ *   void writeChunk(const uint8_t* data, size_t bytes);
+ * };
+ * \endcode
+ * Everything beyond that is optional and advertised by specializing display_traits.
+**/
+
+/** \brief One segment of a vectored write (Display::writeChunkv)
+ *
+ * The segments of one submission are ordered by pixel offset, but not necessarily contiguous. A driver
+ * emits its address window commands wherever a segment does not start where the previous one ended,
+ * and can hand the list to a scatter-gather DMA or a writev-capable transport as it is.
+ *
+ * Segments carry pixel data only, no command bytes: the commands that set a controller's address window
+ * differ from controller to controller, and the framework has no notion of them. The driver derives
+ * them from pixelOffset, typically into a small descriptor of its own that it chains in front of the
+ * segment's data.
+**/
+struct ChunkSegment
+{
+  const uint8_t* data; /**< segment data, points into the page buffer */
+  size_t bytes; /**< number of bytes */
+  size_t pixelOffset; /**< offset of the segment's first pixel in the frame, in buffer order */
+};
+
+
+/** \brief Default capabilities of a Display: none beyond the minimal concept
+ * \tparam Display the Display type
+**/
+template <typename Display>
+struct default_display_traits
+{
+  /** \brief true if the display implements <tt>void seek(size_t pixelOffset)</tt>, which moves its write
+   * position to a pixel offset in the frame (in buffer order). Required for skipping chunks.
+  **/
+  static constexpr bool addressable = false;
+
+  /** \brief true if the display implements <tt>void writeChunkv(const ChunkSegment* segments, size_t count)</tt>,
+   * a vectored write of several segments in one submission. See \ref ChunkSegment.
+  **/
+  static constexpr bool vectored = false;
+
+  /** \brief true if the display implements <tt>void scroll(coordinate_t top, coordinate_t bottom, int dy)</tt>,
+   * which moves the content of the full-width rows top..bottom by dy rows (positive: downwards), e.g. with
+   * a hardware vertical scroll or a RAM copy. Rows that are scrolled in may have any content. Later
+   * writes and seeks use frame offsets as before, so a driver that scrolls by changing its RAM start
+   * address must translate them. Used by OutputManager::scroll().
+  **/
+  static constexpr bool scrollable = false;
+
+  /** \brief the bytes the display expects for a pixel. By default, the display color's storage is sent
+   * as it is. \see wireFormat.h
+  **/
+  typedef wire::native wire_format_t;
+};
+
+
+/** \brief Capabilities of a Display. Specialize this (deriving from default_display_traits) to advertise
+ * optional features.
+ * \tparam Display the Display type
+**/
+template <typename Display>
+struct display_traits : public default_display_traits<Display>
+{
+};
+
+#endif // SFC_OUTPUT_DISPLAY_H
@@ -0,0 +1,149 @@
+/**
+  COMPILE WITH:
+  g++ -O2 -std=c++11 -I../../.. -o 01_remoteDisplay main.cpp
+  in the sfc/output/examples/01_remoteDisplay directory.
+
+  RUN:
+  ./01_remoteDisplay viewer [socket path or TCP port]
+  ./01_remoteDisplay display [socket path or TCP port]
+  in two terminals. The display side draws a moving bar over a gradient, the viewer prints what arrives.
+  The display side also prints the output manager's progress messages.
+**/
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "sfc.h"
+#include "output/fpsLimiter.h"
+#include "output/remote.h"
+
+typedef remote::RemoteDisplay<color::RGB565, 160, 120, remote::Socket> display_t;
+
+struct Frontend
+{
+  typedef color::RGB565 color_t;
+  typedef uint16_t coordinate_t;
+};
+
+template <>
+struct pageBuffer_traits<display_t, Frontend> : public default_pageBuffer_traits<display_t>
+{
+  static constexpr size_t pages = 8;
+  static constexpr size_t maxPixelsPerChunk = 320;
+};
+
+typedef Canvas<display_t, Frontend> canvas_t;
+
+
+/** \brief draws the scene into every page that is sent **/
+struct Scene : public PageRenderer<canvas_t::output_device_t>
+{
+  Scene()
+    : frame(0)
+  {
+  }
+
+  void render(canvas_t::output_device_t& buffer)
+  {
+    size_t bar = (frame*2) % display_t::width;
+    buffer.generate(buffer.bbx(),
+                    [&](size_t x, size_t y)
+                    {
+                      if ((x >= bar) && (x < bar + 10))
+                      {
+                        return color::RGB565(255, 255, 255, color::channel::left_aligned);
+                      }
+                      return color::RGB565(x*255/display_t::width, y*255/display_t::height, 64, color::channel::left_aligned);
+                    });
+  }
+
+  size_t frame;
+};
+
+
+remote::Socket connect(const char* mode, const char* address)
+{
+  bool viewer = std::string(mode) == "viewer";
+  int port = std::atoi(address);
+  if (port > 0)
+  {
+    return viewer ? remote::Socket::acceptTcp(port) : remote::Socket::connectTcp(port);
+  }
+  return viewer ? remote::Socket::acceptUnix(address) : remote::Socket::connectUnix(address);
+}
+
+
+int runViewer(remote::Socket& socket)
+{
+  remote::Viewer<remote::Socket> viewer(socket);
+  if (!viewer.valid())
+  {
+    std::cerr << "no hello from the display\n";
+    return 1;
+  }
+  std::cout << "display: " << viewer.width() << "x" << viewer.height() << ", " << viewer.bitsPerPixel() << " bits per pixel\n";
+  uint32_t last = remote::MonotonicClock::now();
+  uint64_t lastFrames = 0;
+  while (viewer.receive())
+  {
+    uint32_t now = remote::MonotonicClock::now();
+    if (now - last >= 1000000)
+    {
+      std::cout << viewer.frames() - lastFrames << " fps, "
+                << "compression " << (double)viewer.rawBytes()/viewer.receivedBytes() << ":1, "
+                << "latency p50 " << viewer.latency().quantile(50) << " us, p99 " << viewer.latency().quantile(99)
+                << " us, max " << viewer.latency().max() << " us\n";
+      last = now;
+      lastFrames = viewer.frames();
+    }
+  }
+  std::cout << viewer.frames() << " frames in " << viewer.batches() << " batches, "
+            << viewer.receivedBytes() << " bytes received for " << viewer.rawBytes() << " bytes of chunks\n";
+  return 0;
+}
+
+
+int runDisplay(remote::Socket& socket)
+{
+  display_t display(socket);
+  canvas_t canvas(display);
+  Scene scene;
+  canvas.outputDispatcher().setRenderer(&scene);
+  FpsLimiter<remote::MonotonicClock> limiter(30);
+  for (scene.frame = 0; (scene.frame < 600) && display.connected(); scene.frame++)
+  {
+    while (!limiter.due())
+    {
+      display.update();
+    }
+    limiter.begin();
+    while (canvas.outputDispatcher().update() != update_frame)
+    {
+    }
+    while (!canvas.outputDispatcher().frameSent())
+    {
+      canvas.update();
+    }
+  }
+  display.flush();
+  std::cout << display.rawBytes() << " bytes of chunks sent as " << display.sentBytes() << " bytes\n";
+  return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: " << argv[0] << " viewer|display [socket path or TCP port]\n";
+    return 1;
+  }
+  remote::Socket socket = connect(argv[1], (argc > 2) ? argv[2] : "/tmp/sfc_remote.sock");
+  if (!socket.valid())
+  {
+    std::cerr << "could not connect\n";
+    return 1;
+  }
+  return (std::string(argv[1]) == "viewer") ? runViewer(socket) : runDisplay(socket);
+}
@@ -1,6 +1,72 @@
 #ifndef SFC_OUTPUT_FPSLIMITER_H
 #define SFC_OUTPUT_FPSLIMITER_H
 
+#include <cstdint>
 
-#endif // SFC_OUTPUT_FPSLIMITER_H
+/** \brief Limits the frame rate of an output to a target number of frames per second
+ *
+ * Frames are started on a fixed cadence: the next frame is due one period after the previous one was
+ * due, not after it actually started, so occasional late starts don't lower the average rate. If a
+ * frame starts more than a period late, the cadence restarts from there instead of catching up with a burst.
+ *
+ * The clock is a class with <tt>static uint32_t now()</tt> that returns microseconds, see \ref AdaptiveChunks.
+ * \tparam Clock the clock class
+**/
+template <typename Clock>
+class FpsLimiter
+{
+  public:
+    /** \param fps target frame rate, 0 for no limit **/
+    FpsLimiter(unsigned fps = 0)
+      : period_(0),
+      start_(0),
+      started_(false)
+    {
+      setFps(fps);
+    }
+
+    /** \brief set the target frame rate, 0 for no limit **/
+    void setFps(unsigned fps)
+    {
+      period_ = fps ? 1000000u/fps : 0;
+    }
+
+    /** \brief whether a new frame may start at the given time **/
+    bool due(uint32_t now) const
+    {
+      return !started_ || ((uint32_t)(now - start_) >= period_);
+    }
+
+    /** \brief whether a new frame may start now **/
+    bool due() const
+    {
+      return due(Clock::now());
+    }
 
+    /** \brief record that a frame started at the given time **/
+    void begin(uint32_t now)
+    {
+      if (started_ && period_ && ((uint32_t)(now - start_) < 2*period_))
+      {
+        start_ += period_;
+      }
+      else
+      {
+        start_ = now;
+      }
+      started_ = true;
+    }
+
+    /** \brief record that a frame started now **/
+    void begin()
+    {
+      begin(Clock::now());
+    }
+
+  private:
+    uint32_t period_; /**< microseconds per frame, or 0 */
+    uint32_t start_; /**< when the last frame was due */
+    bool started_;
+};
+
+#endif // SFC_OUTPUT_FPSLIMITER_H
@@ -1,7 +1,18 @@
 #ifndef SFC_OUTPUTMANAGER_H
 #define SFC_OUTPUTMANAGER_H
 
-#include "../pageBuffer/PageBuffer.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <type_traits>
+
+#include "../pageBuffer/Arena.h"
+#include "../pageBuffer/DynamicPageBuffer.h"
+#include "chunkFilter.h"
+#include "chunkPolicy.h"
+#include "display.h"
+#include "pageRenderer.h"
+#include "trace.h"
 
 namespace output_mode
 {
@@ -9,20 +20,57 @@ namespace output_mode
   struct direct {};
 
 
-  /** \brief buffered drawing tag, a \ref PageBuffer is used **/
+  /** \brief buffered drawing tag, a \ref PageBuffer (or a \ref DynamicPageBuffer) is used **/
   struct buffered {};
 }
 
 
+/** \brief What a call to OutputManager::update() did, or why a time-budgeted update returned **/
+enum update_state
+{
+  update_busy, /**< the display was busy */
+  update_chunk, /**< a chunk was sent or skipped (or a page, with vectored writes) */
+  update_page, /**< the next page was started, the application may draw into it */
+  update_frame, /**< a new frame was started, the application may draw into its first page */
+  update_idle, /**< the frame was sent and no new frame is allowed yet */
+  update_timeout /**< the time budget ran out */
+};
+
+
+/** \brief Default output traits
+ * \tparam D the Display class
+ * \tparam F the Frontend class
+**/
+template <typename D, typename F>
+struct default_output_traits
+{
+  typedef output_mode::buffered type;
+
+  /** \brief By default, every chunk is sent. \see ContentHashFilter **/
+  typedef AllChunks chunk_filter_t;
+
+  /** \brief By default, every chunk is sent with its own write. \see AdaptiveChunks **/
+  typedef FixedChunks chunk_policy_t;
+
+  /** \brief By default, nothing is traced. \see trace.h **/
+  typedef trace::none trace_t;
+
+  /** \brief By default, every frame is sent completely. If true, the application marks its changes with
+   * OutputManager::invalidate(const bbx_t&), and a frame only sends the pages that contain marked rows.
+   * Requires an addressable or vectored display.
+  **/
+  static constexpr bool damage_tracking = false;
+};
+
+
 /** \brief Output traits class
  * Defines the output properties for the given Frontend and Display
  * \tparam D the Display class
  * \tparam F the Frontend class
 **/
 template <typename D, typename F>
-struct output_traits
+struct output_traits : public default_output_traits<D, F>
 {
-  typedef output_mode::buffered type;
 };
 
 
@@ -75,6 +123,10 @@ class OutputManager<Display, Frontend, output_mode::direct>
 
 
 /** \brief Output Dispatcher for buffered displays
+ *
+ * With sizing::runtime in \ref pageBuffer_traits, the page buffer is a \ref DynamicPageBuffer, and the
+ * page and chunk bookkeeping, i.e. the damaged pages, the vectored write's segments and the chunk filter's
+ * state, is sized at runtime and taken from the same allocator as the pixels.
  * \tparam Display the Display class
  * \tparam Frontend the Frontend class
 **/
@@ -84,24 +136,228 @@ class OutputManager<Display, Frontend, output_mode::buffered>
   public:
     OutputManager(Display& display)
       : display_(display),
-      pixelsLeftInPage_(0)
+      pixelsLeftInPage_(0),
+      writePosition_(0),
+      renderer_(0),
+      frame_(0),
+      valid_(true)
     {
+      region_.fill(true);
+      if (partialFrames)
+      {
+        // the display's content is unknown, so the first frame is sent completely
+        pending_.fill(true);
+      }
     }
 
-    typedef PageBuffer<Display, Frontend> buffer_t;
+    /** \brief create an output manager with a \ref DynamicPageBuffer, see sizing::runtime in \ref pageBuffer_traits
+     * \param display the display
+     * \param width display width
+     * \param height display height
+     * \param pages number of pages
+     * \param maxPixelsPerChunk maximum number of pixels per chunk
+     * \param allocator the allocator that provides the page buffer and the bookkeeping, see \ref Arena
+     * \param alignment alignment of the storage, a power of two
+    **/
+    template <typename Allocator>
+    OutputManager(Display& display, typename Display::coordinate_t width, typename Display::coordinate_t height,
+                  size_t pages, size_t maxPixelsPerChunk, Allocator& allocator, size_t alignment = buffer_alignment)
+      : buffer_(width, height, pages, maxPixelsPerChunk, allocator, alignment),
+      display_(display),
+      pixelsLeftInPage_(0),
+      writePosition_(0),
+      renderer_(0),
+      frame_(0),
+      valid_(false)
+    {
+      valid_ = buffer_.valid()
+        && region_.allocate(allocator, buffer_.pageCount(), alignment)
+        && pending_.allocate(allocator, buffer_.pageCount(), alignment)
+        && (!vectored || segments_.allocate(allocator, pageChunks(), alignment))
+        && chunkFilter_.allocate(allocator, buffer_.pageCount()*pageChunks(), alignment);
+      region_.fill(true);
+      if (partialFrames)
+      {
+        // the display's content is unknown, so the first frame is sent completely
+        pending_.fill(true);
+      }
+    }
+
+    typedef typename page_buffer<Display, Frontend>::type buffer_t;
+    typedef typename buffer_t::bbx_t bbx_t;
     typedef Display display_t;
+    typedef typename output_traits<Display, Frontend>::chunk_filter_t chunk_filter_t;
+    typedef typename output_traits<Display, Frontend>::chunk_policy_t chunk_policy_t;
+    typedef typename output_traits<Display, Frontend>::trace_t trace_t;
+
+    /** \brief whole pages are submitted with one vectored write, if the display supports it and chunks
+     * don't need a staging copy
+    **/
+    static constexpr bool vectored = display_traits<Display>::vectored && buffer_t::inPlace;
+
+    static_assert(!chunk_filter_t::skips || display_traits<Display>::addressable || vectored,
+                  "OutputManager: skipping chunks requires an addressable or vectored display, see display_traits.");
+
+    /** \brief frames skip pages that contain no damaged rows, see damage_tracking in \ref output_traits **/
+    static constexpr bool partialFrames = output_traits<Display, Frontend>::damage_tracking;
+
+    static_assert(!partialFrames || display_traits<Display>::addressable || vectored,
+                  "OutputManager: damage tracking requires an addressable or vectored display, see display_traits.");
+
+    /** \brief one flag per page **/
+    typedef StorageArray<bool, buffer_t::pages> pages_t;
+
+    /** \brief number of chunk slots per page, runtime_size for a \ref DynamicPageBuffer **/
+    static constexpr size_t chunksPerPage = buffer_t::maxPixelsPerChunk
+      ? (buffer_t::pixelsPerPage + buffer_t::maxPixelsPerChunk - 1)/buffer_t::maxPixelsPerChunk : runtime_size;
+
+    /** \brief number of bits per pixel in the display's wire format **/
+    static constexpr size_t wireBits = wire::pixel_bits<typename display_traits<Display>::wire_format_t, typename Display::color_t>::value;
+
+    /** \brief number of bytes an allocator must provide for the runtime constructor **/
+    static size_t storageSize(typename Display::coordinate_t width, typename Display::coordinate_t height,
+                              size_t pages, size_t maxPixelsPerChunk, size_t alignment = buffer_alignment)
+    {
+      typename buffer_t::Geometry geometry(width, height, pages);
+      size_t chunks = maxPixelsPerChunk ? (geometry.pixelsPerPage + maxPixelsPerChunk - 1)/maxPixelsPerChunk : 0;
+      return buffer_t::storageSize(width, height, pages, maxPixelsPerChunk, alignment)
+        + 2*StorageArray<bool, runtime_size>::storageSize(geometry.pages, alignment)
+        + (vectored ? StorageArray<ChunkSegment, runtime_size>::storageSize(chunks, alignment) : 0)
+        + chunk_filter_t::storageSize(geometry.pages*chunks, alignment);
+    }
+
+    /** \brief false if the runtime constructor's dimensions are invalid or its allocator couldn't provide
+     * the storage. Nothing is sent then.
+    **/
+    bool valid() const
+    {
+      return valid_;
+    }
 
+    /** \brief send the next chunk, or the whole page if vectored writes are used **/
     void writeChunk()
     {
-      size_t chunkOffset = buffer_t::pixelsPerPage - pixelsLeftInPage_;
-      size_t chunkSize = std::min((size_t)buffer_t::maxPixelsPerChunk, pixelsLeftInPage_);
-      size_t bytes = (color::colorRepresentation_traits<typename Display::color_t>::storage_bit_size*chunkSize)/8;
-      const uint8_t* data = buffer_.makeChunk(chunkOffset, chunkSize);
-      std::cout << "OutputManager::writeChunk() : sending " << chunkSize << " pixels starting at " << chunkOffset << "\n"
-                << "  data starts at " << std::hex << (size_t)data << ", " << std::dec << bytes << " bytes\n";
-      display().writeChunk(data, bytes);
-      pixelsLeftInPage_ -= chunkSize;
-      std::cout << "  " << pixelsLeftInPage_ << " pixels left in page\n";
+      writeChunk(std::integral_constant<bool, vectored>());
+    }
+
+    /** \brief make the chunk filter forget what was sent, so that the next frame is sent completely.
+     * Call this when the display's content was lost, e.g. after a reset.
+    **/
+    void invalidate()
+    {
+      chunkFilter_.invalidate();
+      damage(0, buffer_.dimensions().y() - 1);
+    }
+
+    /** \brief mark an area as changed
+     *
+     * Only has an effect with damage_tracking (see \ref output_traits): a frame then only sends the pages
+     * that contain rows marked before it started, and nothing if there are none. The first frame is sent
+     * completely. Without damage tracking, every frame is sent completely.
+    **/
+    void invalidate(const bbx_t& area)
+    {
+      if (area.valid())
+      {
+        damage(area.top(), area.bottom());
+      }
+    }
+
+    /** \brief scroll the content of an area
+     *
+     * The current page's buffer content is moved, see PageBuffer::scroll(). With damage_tracking (see
+     * \ref output_traits), if the display is scrollable (see display_traits) and the area is a band of
+     * full-width rows scrolled vertically, the display moves its content, and only the strip that is
+     * scrolled in is marked as changed: the next frame skips all pages without it, and nothing has to be
+     * redrawn across page boundaries. Otherwise, all rows are marked, i.e. the next frame is sent completely
+     * as without damage tracking.
+     * \param area the area to scroll
+     * \param dx horizontal distance, positive to the right
+     * \param dy vertical distance, positive downwards
+    **/
+    void scroll(const bbx_t& area, int dx, int dy)
+    {
+      buffer_.scroll(area, dx, dy);
+      if (!area.valid() || (dy == 0 && dx == 0))
+      {
+        return;
+      }
+      int top = area.top();
+      int bottom = area.bottom();
+      if (partialFrames && display_traits<Display>::scrollable && (dx == 0)
+          && (area.left() == 0) && (area.right() == buffer_.dimensions().x() - 1) && (std::abs(dy) <= bottom - top))
+      {
+        hardwareScroll(area.top(), area.bottom(), dy, std::integral_constant<bool, display_traits<Display>::scrollable>());
+        // the display now shows different content in the area than what the chunk filter knows
+        chunkFilter_.invalidate();
+        // rows marked earlier moved with the content: keep them, and mark where they went to. Pages are
+        // visited in the direction of the scroll, so rows are only marked in pages that were already visited.
+        const size_t pages = buffer_.pageCount();
+        for (size_t k = 0; k < pages; k++)
+        {
+          size_t p = (dy > 0) ? pages - 1 - k : k;
+          if (pending_[p])
+          {
+            damageMoved(buffer_.pageBbx(p), top, bottom, dy);
+          }
+        }
+        damage((dy > 0) ? top : bottom + dy + 1, (dy > 0) ? top + dy - 1 : bottom);
+        // rows the current frame has yet to send are stale on the display, and so is where they were moved to
+        if (!frameSent())
+        {
+          for (size_t p = buffer_.page(); p < pages; p++)
+          {
+            if (region_[p])
+            {
+              damageMoved(buffer_.pageBbx(p), top, bottom, dy);
+            }
+          }
+        }
+      }
+      else
+      {
+        damage(0, buffer_.dimensions().y() - 1);
+      }
+    }
+
+    /** \brief set the renderer that draws retained content into every page the frame sends, e.g. a
+     * \ref layer::Compositor
+     * \param renderer the renderer, or 0 for none
+    **/
+    void setRenderer(PageRenderer<buffer_t>* renderer)
+    {
+      renderer_ = renderer;
+    }
+
+    /** \brief the tracer, e.g. to export a \ref trace::Recorder **/
+    trace_t& tracer()
+    {
+      return tracer_;
+    }
+
+    const trace_t& tracer() const
+    {
+      return tracer_;
+    }
+
+    /** \brief number of the current frame, incremented whenever a frame starts **/
+    uint32_t frame() const
+    {
+      return frame_;
+    }
+
+    /** \brief the chunk policy, e.g. to read the estimates of \ref AdaptiveChunks **/
+    const chunk_policy_t& chunkPolicy() const
+    {
+      return chunkPolicy_;
+    }
+
+    /** \brief whether the current frame was sent completely, so that the next update() starts a new one
+     * (if the display is ready and newFrameAllowed())
+    **/
+    bool frameSent() const
+    {
+      return !pixelsLeftInPage_ && (buffer_.page() == buffer_.pageCount() - 1);
     }
 
     bool newFrameAllowed()
@@ -112,61 +368,314 @@ class OutputManager<Display, Frontend, output_mode::buffered>
     void beginPage()
     {
       std::cout << "OutputManager::beginPage() : draw()\n";
-      pixelsLeftInPage_ = buffer_t::pixelsPerPage;
-      writeChunk();
+      bool damaged = region_[buffer_.page()];
+      pixelsLeftInPage_ = damaged ? buffer_.pagePixels() : 0;
+      if (damaged)
+      {
+        tracer_.begin(trace::page);
+      }
+      if (damaged && renderer_)
+      {
+        tracer_.begin(trace::render);
+        renderer_->render(buffer_);
+        tracer_.end(trace::render, frame_, buffer_.page(), 0);
+      }
     }
 
-    void update()
+    /** \brief send the next chunk, or start the next page or frame, if the display is ready
+     * \return what was done
+    **/
+    update_state update()
     {
+      tracer_.end(trace::draw, frame_, buffer_.page(), 0);
+      update_state state = step();
+      tracer_.begin(trace::draw);
+      return state;
+    }
+
+    /** \brief keep sending chunks and starting pages and frames while the display is ready, until a time
+     * budget is used up
+     *
+     * The budget is checked after every step, so the last step may exceed it by the duration of one chunk.
+     * \tparam Clock a class with <tt>static uint32_t now()</tt>, see \ref AdaptiveChunks
+     * \param budget time budget in the clock's unit, e.g. microseconds
+     * \param stopAtPage return when a page or frame was started, so that the application can draw into the
+     *        new page. Pass false if the pages don't need the application, e.g. when everything is drawn by
+     *        a \ref layer::Compositor.
+     * \return update_busy or update_idle if the display can't take more, update_page or update_frame if
+     *         stopped at a page, otherwise update_timeout
+    **/
+    template <typename Clock>
+    update_state update(uint32_t budget, bool stopAtPage = true)
+    {
+      const uint32_t start = Clock::now();
+      tracer_.end(trace::draw, frame_, buffer_.page(), 0);
+      update_state state;
+      while (true)
+      {
+        state = step();
+        if ((state == update_busy) || (state == update_idle)
+            || (stopAtPage && ((state == update_page) || (state == update_frame))))
+        {
+          break;
+        }
+        if ((uint32_t)(Clock::now() - start) >= budget)
+        {
+          state = update_timeout;
+          break;
+        }
+      }
+      tracer_.begin(trace::draw);
+      return state;
+    }
+
+    buffer_t& outputDevice()
+    {
+      return buffer_;
+    }
+
+    const buffer_t& outputDevice() const
+    {
+      return buffer_;
+    }
+
+    display_t& display()
+    {
+      return  display_;
+    }
+
+    const display_t& display() const
+    {
+      return  display_;
+    }
+  private:
+    /** \brief one step of update() **/
+    update_state step()
+    {
+      if (!valid())
+      {
+        return update_idle;
+      }
       display().update();
       if (display().ready())
       {
         std::cout << "OutputManager::update() : display is ready\n";
+        tracer_.end(trace::wait, frame_, buffer_.page(), 0);
         if (pixelsLeftInPage_) // page not finished : write next chunk
         {
           std::cout << "OutputManager::update() : there are pixels left in the page\n";
           writeChunk();
+          if (frameSent())
+          {
+            tracer_.end(trace::frame, frame_, buffer_.page(), 0);
+          }
+          return update_chunk;
         }
         else if (buffer_.advance()) // frame not finished: start next page
         {
           beginPage();
+          return update_page;
         }
         else if (newFrameAllowed()) // frame finished, see if a new one may be started
         {
           std::cout << "OutputManager::update() : new frame\n";
+          tracer_.end(trace::frame, frame_, buffer_.page(), 0);
+          frame_++;
+          tracer_.begin(trace::frame);
+          beginRegion();
           buffer_.beginFrame();
           beginPage();
+          return update_frame;
         }
+        return update_idle;
       }
       else
       {
         std::cout << "OutputManager::update() : display is busy\n";
+        tracer_.begin(trace::wait);
+        return update_busy;
       }
     }
 
-    buffer_t& outputDevice()
+    /** \brief send the next chunk. If the chunks point into the page buffer, as many following changed
+     * chunks as the chunk policy asks for are coalesced into the same write.
+    **/
+    void writeChunk(std::false_type)
     {
-      return buffer_;
+      size_t chunkOffset = buffer_.pagePixels() - pixelsLeftInPage_;
+      size_t frameOffset = buffer_.pageOffset() + chunkOffset;
+      size_t chunks = buffer_t::inPlace ? chunkPolicy_.chunks((wireBits*buffer_.chunkPixels())/8) : 1;
+      const uint8_t* data = 0;
+      size_t chunkSize = 0;
+      size_t bytes = 0;
+      for (size_t i = 0; (i < chunks) && pixelsLeftInPage_; i++)
+      {
+        size_t offset = buffer_.pagePixels() - pixelsLeftInPage_;
+        size_t size = std::min(buffer_.chunkPixels(), pixelsLeftInPage_);
+        size_t n = (wireBits*size)/8;
+        size_t slot = buffer_.page()*pageChunks() + offset/buffer_.chunkPixels();
+        tracer_.begin(trace::convert);
+        const uint8_t* chunk = buffer_.makeChunk(offset, size);
+        tracer_.end(trace::convert, frame_, buffer_.page(), offset/buffer_.chunkPixels());
+        pixelsLeftInPage_ -= size;
+        if (!chunkFilter_.changed(slot, chunk, n))
+        {
+          break;
+        }
+        if (!data)
+        {
+          data = chunk;
+        }
+        chunkSize += size;
+        bytes += n;
+      }
+      if (data)
+      {
+        std::cout << "OutputManager::writeChunk() : sending " << chunkSize << " pixels starting at " << chunkOffset << "\n"
+                  << "  data starts at " << std::hex << (size_t)data << ", " << std::dec << bytes << " bytes\n";
+        if (writePosition_ != frameOffset)
+        {
+          seek(frameOffset, std::integral_constant<bool, display_traits<Display>::addressable>());
+        }
+        chunkPolicy_.begin();
+        tracer_.begin(trace::write);
+        display().writeChunk(data, bytes);
+        tracer_.end(trace::write, frame_, buffer_.page(), chunkOffset/buffer_.chunkPixels());
+        tracer_.sent(bytes, chunkSize);
+        chunkPolicy_.end(bytes);
+        writePosition_ = (frameOffset + chunkSize) % buffer_.framePixels();
+      }
+      if (!pixelsLeftInPage_)
+      {
+        tracer_.end(trace::page, frame_, buffer_.page(), 0);
+      }
+      std::cout << "  " << pixelsLeftInPage_ << " pixels left in page\n";
     }
 
-    const buffer_t& outputDevice() const
+    /** \brief send all changed chunks of the page with one vectored write. Chunks that are adjacent in
+     * the page buffer are merged into one segment.
+    **/
+    void writeChunk(std::true_type)
     {
-      return buffer_;
+      // the segments of a compile-time page buffer live on the stack, those of a DynamicPageBuffer were allocated
+      StorageArray<ChunkSegment, chunksPerPage> local;
+      ChunkSegment* segments = chunksPerPage ? local.data() : segments_.data();
+      size_t count = 0;
+      size_t pixels = 0;
+      size_t pagePixels = buffer_.pagePixels();
+      const size_t chunkPixels = buffer_.chunkPixels();
+      for (size_t chunkOffset = 0; chunkOffset < pagePixels; chunkOffset += chunkPixels)
+      {
+        size_t chunkSize = std::min(chunkPixels, pagePixels - chunkOffset);
+        size_t bytes = (wireBits*chunkSize)/8;
+        size_t slot = buffer_.page()*pageChunks() + chunkOffset/chunkPixels;
+        tracer_.begin(trace::convert);
+        const uint8_t* data = buffer_.makeChunk(chunkOffset, chunkSize);
+        tracer_.end(trace::convert, frame_, buffer_.page(), chunkOffset/chunkPixels);
+        if (!chunkFilter_.changed(slot, data, bytes))
+        {
+          continue;
+        }
+        pixels += chunkSize;
+        if (count && (segments[count - 1].data + segments[count - 1].bytes == data))
+        {
+          segments[count - 1].bytes += bytes;
+        }
+        else
+        {
+          segments[count].data = data;
+          segments[count].bytes = bytes;
+          segments[count].pixelOffset = buffer_.pageOffset() + chunkOffset;
+          count++;
+        }
+      }
+      if (count)
+      {
+        tracer_.begin(trace::write);
+        display().writeChunkv(segments, count);
+        tracer_.end(trace::write, frame_, buffer_.page(), 0);
+        tracer_.sent((wireBits*pixels)/8, pixels);
+      }
+      tracer_.end(trace::page, frame_, buffer_.page(), 0);
+      writePosition_ = (buffer_.pageOffset() + pagePixels) % buffer_.framePixels();
+      pixelsLeftInPage_ = 0;
     }
 
-    display_t& display()
+    void seek(size_t, std::false_type)
     {
-      return  display_;
     }
 
-    const display_t& display() const
+    void hardwareScroll(int, int, int, std::false_type)
     {
-      return  display_;
     }
-  private:
+
+    void hardwareScroll(int top, int bottom, int dy, std::true_type)
+    {
+      display().scroll(top, bottom, dy);
+    }
+
+    /** \brief mark the pages that contain rows top..bottom for the next frame **/
+    void damage(int top, int bottom)
+    {
+      if (!partialFrames)
+      {
+        return;
+      }
+      for (size_t p = 0; p < buffer_.pageCount(); p++)
+      {
+        bbx_t page = buffer_.pageBbx(p);
+        if ((page.top() <= bottom) && (page.bottom() >= top))
+        {
+          pending_[p] = true;
+        }
+      }
+    }
+
+    /** \brief mark where the rows of a page that lie in the scrolled band top..bottom went to **/
+    void damageMoved(const bbx_t& page, int top, int bottom, int dy)
+    {
+      int first = std::max<int>(top, page.top()) + dy;
+      int last = std::min<int>(bottom, page.bottom()) + dy;
+      if ((first <= bottom) && (last >= top) && (first <= last))
+      {
+        damage(std::max(top, first), std::min(bottom, last));
+      }
+    }
+
+    /** \brief start a frame with the pages that were marked. Without damage tracking, all pages are sent. **/
+    void beginRegion()
+    {
+      if (partialFrames)
+      {
+        std::copy(pending_.begin(), pending_.end(), region_.begin());
+        pending_.fill(false);
+      }
+    }
+
+    void seek(size_t pixelOffset, std::true_type)
+    {
+      display().seek(pixelOffset);
+    }
+
+    /** \brief number of chunk slots per page **/
+    size_t pageChunks() const
+    {
+      return chunksPerPage ? (size_t)chunksPerPage : (buffer_.pageCapacity() + buffer_.chunkPixels() - 1)/buffer_.chunkPixels();
+    }
+
     buffer_t buffer_;
     display_t& display_;
     size_t pixelsLeftInPage_;
+    chunk_filter_t chunkFilter_;
+    chunk_policy_t chunkPolicy_;
+    size_t writePosition_; /**< pixel offset in the frame where the display will continue writing */
+    pages_t region_; /**< pages the current frame sends */
+    pages_t pending_; /**< pages marked for the next frame */
+    StorageArray<ChunkSegment, runtime_size> segments_; /**< segments of a vectored write, for a DynamicPageBuffer */
+    PageRenderer<buffer_t>* renderer_; /**< draws retained content into every page that is sent, or 0 */
+    trace_t tracer_;
+    uint32_t frame_; /**< number of the current frame */
+    bool valid_; /**< whether the runtime constructor got its storage */
 };
 
 #endif // SFC_OUTPUTMANAGER_H
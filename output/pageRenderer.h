@@ -0,0 +1,24 @@
+#ifndef SFC_OUTPUT_PAGERENDERER_H
+#define SFC_OUTPUT_PAGERENDERER_H
+
+/** \brief Something that draws retained content into every page when it begins, before the page is sent
+ *
+ * An OutputManager calls the renderer it was given (see OutputManager::setRenderer()) right after a page was
+ * cleared, and only for pages the frame actually sends. Whatever the application draws into the page
+ * afterwards is drawn on top. See \ref layer::Compositor.
+ * \tparam Buffer the page buffer type
+**/
+template <typename Buffer>
+class PageRenderer
+{
+  public:
+    /** \brief draw into the buffer's current page **/
+    virtual void render(Buffer& buffer) = 0;
+
+  protected:
+    ~PageRenderer()
+    {
+    }
+};
+
+#endif // SFC_OUTPUT_PAGERENDERER_H
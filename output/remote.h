@@ -0,0 +1,719 @@
+#ifndef SFC_OUTPUT_REMOTE_H
+#define SFC_OUTPUT_REMOTE_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "../color/colorRepresentation.h"
+#include "display.h"
+#include "statistics.h"
+
+/** \file remote.h A display that streams its chunks to a viewer process over a local socket (POSIX)
+
+ * \ref remote::RemoteDisplay is a Display for remote debugging and kiosk mirroring. It sends what the
+ * output manager writes over a Unix domain or loopback TCP socket (\ref remote::Socket) to a
+ * \ref remote::Viewer, which reconstructs the frame and measures the end-to-end latency:
+ * \code
+ * // application
+ * typedef remote::RemoteDisplay<color::RGB565, 320, 240, remote::Socket, remote::MonotonicClock> display_t;
+ * remote::Socket socket = remote::Socket::connectUnix("/tmp/sfc.sock");
+ * display_t display(socket);
+ * Canvas<display_t> canvas(display);
+ *
+ * // viewer process
+ * remote::Socket socket = remote::Socket::acceptUnix("/tmp/sfc.sock");
+ * remote::Viewer<remote::Socket, remote::MonotonicClock> viewer(socket);
+ * while (viewer.receive())
+ * {
+ *   // viewer.frame(), viewer.latency().quantile(99), ...
+ * }
+ * \endcode
+ * To save bandwidth, every chunk is XORed with what was sent for the same pixels before (both ends keep
+ * the last frame), so unchanged bytes become zeros, and the result is run-length encoded. Encoded chunks
+ * are collected into batches, which are sent when they are full, when a new frame begins, when the last
+ * pixel of the frame was written, or when the oldest chunk waited for the maximum delay.
+ *
+ * Protocol (little-endian, \c v is an unsigned LEB128 varint):
+ * \code
+ * hello: "SFCV" u8:version u8:bitsPerPixel u16:width u16:height u32:batchBytes   batchBytes: largest batch, header included
+ * batch: u32:payloadBytes u32:time payload                  time: sender's clock when the first chunk was written
+ * chunk: v:pixelOffset v:bytes tokens                       the tokens decode to bytes bytes
+ * token: v:(n << 1) u8[n]  |  v:(n << 1 | 1) u8            n literal bytes, or one byte repeated n times
+ * \endcode
+ * The latency is measured with the same monotonic clock in both processes, so both must run on the same host.
+**/
+
+/** \brief Streaming of display contents to a viewer process, see \ref remote.h **/
+namespace remote
+{
+
+/** \brief protocol version in the hello message **/
+static constexpr uint8_t version = 2;
+
+/** \brief size of the hello message **/
+static constexpr size_t helloBytes = 14;
+
+/** \brief size of a batch header **/
+static constexpr size_t batchHeaderBytes = 8;
+
+
+/** \brief microseconds of CLOCK_MONOTONIC, which is the same in all processes of a host **/
+struct MonotonicClock
+{
+  static uint32_t now()
+  {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint32_t)((uint64_t)t.tv_sec*1000000 + t.tv_nsec/1000);
+  }
+};
+
+
+/** \brief A connected stream socket, Unix domain or loopback TCP. The Transport of RemoteDisplay and Viewer. **/
+class Socket
+{
+  public:
+    Socket()
+      : fd_(-1)
+    {
+    }
+
+    explicit Socket(int fd)
+      : fd_(fd)
+    {
+    }
+
+    Socket(Socket&& other)
+      : fd_(other.fd_)
+    {
+      other.fd_ = -1;
+    }
+
+    Socket& operator=(Socket&& other)
+    {
+      std::swap(fd_, other.fd_);
+      return *this;
+    }
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    ~Socket()
+    {
+      if (fd_ >= 0)
+      {
+        ::close(fd_);
+      }
+    }
+
+    /** \brief connect to a viewer listening on a Unix domain socket **/
+    static Socket connectUnix(const char* path)
+    {
+      sockaddr_un address = unixAddress(path);
+      int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if ((fd >= 0) && (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0))
+      {
+        ::close(fd);
+        fd = -1;
+      }
+      return Socket(fd);
+    }
+
+    /** \brief connect to a viewer listening on a TCP port of the loopback interface **/
+    static Socket connectTcp(uint16_t port)
+    {
+      sockaddr_in address = loopbackAddress(port);
+      int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      if ((fd >= 0) && (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0))
+      {
+        ::close(fd);
+        fd = -1;
+      }
+      noDelay(fd);
+      return Socket(fd);
+    }
+
+    /** \brief listen on a Unix domain socket and wait for one connection **/
+    static Socket acceptUnix(const char* path)
+    {
+      sockaddr_un address = unixAddress(path);
+      ::unlink(path);
+      Socket s = acceptOne(::socket(AF_UNIX, SOCK_STREAM, 0), reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+      ::unlink(path);
+      return s;
+    }
+
+    /** \brief listen on a TCP port of the loopback interface and wait for one connection **/
+    static Socket acceptTcp(uint16_t port)
+    {
+      sockaddr_in address = loopbackAddress(port);
+      int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      int reuse = 1;
+      if (fd >= 0)
+      {
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+      }
+      Socket s = acceptOne(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+      noDelay(s.fd_);
+      return s;
+    }
+
+    bool valid() const
+    {
+      return fd_ >= 0;
+    }
+
+    /** \brief send all bytes
+     * \return false if the connection is lost
+    **/
+    bool send(const uint8_t* data, size_t bytes)
+    {
+#if defined(MSG_NOSIGNAL)
+      const int flags = MSG_NOSIGNAL;
+#else
+      const int flags = 0;
+#endif
+      while (bytes && valid())
+      {
+        ssize_t n = ::send(fd_, data, bytes, flags);
+        if (n <= 0)
+        {
+          return false;
+        }
+        data += n;
+        bytes -= n;
+      }
+      return valid();
+    }
+
+    /** \brief receive exactly the given number of bytes
+     * \return false if the connection is closed
+    **/
+    bool receive(uint8_t* data, size_t bytes)
+    {
+      while (bytes && valid())
+      {
+        ssize_t n = ::recv(fd_, data, bytes, 0);
+        if (n <= 0)
+        {
+          return false;
+        }
+        data += n;
+        bytes -= n;
+      }
+      return valid();
+    }
+
+  private:
+    static sockaddr_un unixAddress(const char* path)
+    {
+      sockaddr_un address;
+      std::memset(&address, 0, sizeof(address));
+      address.sun_family = AF_UNIX;
+      std::strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+      return address;
+    }
+
+    static sockaddr_in loopbackAddress(uint16_t port)
+    {
+      sockaddr_in address;
+      std::memset(&address, 0, sizeof(address));
+      address.sin_family = AF_INET;
+      address.sin_port = htons(port);
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      return address;
+    }
+
+    static void noDelay(int fd)
+    {
+      // chunks are batched already
+      int on = 1;
+      if (fd >= 0)
+      {
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      }
+    }
+
+    static Socket acceptOne(int fd, const sockaddr* address, socklen_t size)
+    {
+      int connection = -1;
+      if ((fd >= 0) && (::bind(fd, address, size) == 0) && (::listen(fd, 1) == 0))
+      {
+        connection = ::accept(fd, 0, 0);
+      }
+      if (fd >= 0)
+      {
+        ::close(fd);
+      }
+      return Socket(connection);
+    }
+
+    int fd_;
+};
+
+
+/** \brief write a varint
+ * \return number of bytes written, at most 10
+**/
+inline size_t putVarint(uint8_t* out, uint64_t value)
+{
+  size_t n = 0;
+  do
+  {
+    out[n++] = (value & 0x7F) | ((value > 0x7F) ? 0x80 : 0);
+    value >>= 7;
+  } while (value);
+  return n;
+}
+
+
+/** \brief read a varint
+ * \return false if it doesn't end before end
+**/
+inline bool getVarint(const uint8_t*& in, const uint8_t* end, size_t& value)
+{
+  value = 0;
+  for (size_t shift = 0; (in < end) && (shift < 8*sizeof(size_t)); shift += 7)
+  {
+    uint8_t byte = *in++;
+    value |= (size_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/** \brief largest number of bytes a chunk of the given size encodes to, including its offset and size.
+ * Every run (at least 4 bytes) saves more than the token of the literal after it costs.
+**/
+inline size_t encodedBound(size_t bytes)
+{
+  return bytes + bytes/64 + 32;
+}
+
+
+/** \brief delta-encode a chunk against the previous data at the same place, see \ref remote.h
+ * \param out where to write the chunk, room for encodedBound(bytes) bytes
+ * \param pixelOffset offset of the chunk's first pixel
+ * \param data the chunk
+ * \param previous the previous data, replaced with the chunk
+ * \param bytes number of bytes
+ * \return number of bytes written
+**/
+inline size_t encode(uint8_t* out, size_t pixelOffset, const uint8_t* data, uint8_t* previous, size_t bytes)
+{
+  static constexpr size_t minRun = 4;
+  uint8_t* o = out;
+  o += putVarint(o, pixelOffset);
+  o += putVarint(o, bytes);
+  size_t literal = 0; // start of the literal bytes not written yet
+  size_t i = 0;
+  while (i < bytes)
+  {
+    uint8_t delta = data[i] ^ previous[i];
+    size_t j = i + 1;
+    while ((j < bytes) && ((uint8_t)(data[j] ^ previous[j]) == delta))
+    {
+      j++;
+    }
+    if (j - i >= minRun)
+    {
+      if (literal < i)
+      {
+        o += putVarint(o, (uint64_t)(i - literal) << 1);
+        for (size_t k = literal; k < i; k++)
+        {
+          *o++ = data[k] ^ previous[k];
+        }
+      }
+      o += putVarint(o, ((uint64_t)(j - i) << 1) | 1);
+      *o++ = delta;
+      literal = j;
+    }
+    i = j;
+  }
+  if (literal < bytes)
+  {
+    o += putVarint(o, (uint64_t)(bytes - literal) << 1);
+    for (size_t k = literal; k < bytes; k++)
+    {
+      *o++ = data[k] ^ previous[k];
+    }
+  }
+  std::memcpy(previous, data, bytes);
+  return o - out;
+}
+
+
+/** \brief A Display that sends its chunks to a \ref Viewer, see \ref remote.h
+ *
+ * The display is addressable and vectored (see display_traits), so chunk filters and partial frames work
+ * as with a local panel. It keeps a copy of the frame as it was sent, so it is meant for a host.
+ * \tparam Color the color type
+ * \tparam Width, Height the size in pixels
+ * \tparam Transport the connection, e.g. a \ref Socket, with <tt>bool send(const uint8_t* data, size_t bytes)</tt>
+ * \tparam Clock a monotonic clock with <tt>static uint32_t now()</tt> in microseconds, the viewer's clock
+ * \tparam BatchBytes size of a batch, at least 256 bytes
+**/
+template <typename Color, uint16_t Width, uint16_t Height, typename Transport, typename Clock = MonotonicClock, size_t BatchBytes = 16384>
+class RemoteDisplay
+{
+  static_assert(BatchBytes >= 256, "remote::RemoteDisplay: batches must have at least 256 bytes");
+
+  public:
+    typedef Color color_t;
+    typedef uint16_t coordinate_t;
+    static constexpr coordinate_t width = Width;
+    static constexpr coordinate_t height = Height;
+
+    /** \brief connect the display to a viewer; the hello message is sent at once
+     * \param transport the connection to the viewer. It must outlive the display.
+     * \param maxDelay microseconds a written chunk may wait in a batch
+    **/
+    RemoteDisplay(Transport& transport, uint32_t maxDelay = 5000)
+      : transport_(transport), connected_(true), position_(0), end_(0), used_(batchHeaderBytes), batchTime_(0),
+      maxDelay_(maxDelay), rawBytes_(0), sentBytes_(0), previous_()
+    {
+      uint8_t hello[helloBytes] = {'S', 'F', 'C', 'V', version, (uint8_t)bits,
+                                   (uint8_t)(Width & 0xFF), (uint8_t)(Width >> 8),
+                                   (uint8_t)(Height & 0xFF), (uint8_t)(Height >> 8),
+                                   (uint8_t)BatchBytes, (uint8_t)(BatchBytes >> 8),
+                                   (uint8_t)(BatchBytes >> 16), (uint8_t)(BatchBytes >> 24)};
+      send(hello, helloBytes);
+    }
+
+    /** \brief send the batch if its oldest chunk waited long enough **/
+    void update()
+    {
+      if ((used_ > batchHeaderBytes) && ((uint32_t)(Clock::now() - batchTime_) >= maxDelay_))
+      {
+        flush();
+      }
+    }
+
+    /** \brief chunks are copied when they are written, so the display is always ready **/
+    bool ready()
+    {
+      return true;
+    }
+
+    void writeChunk(const uint8_t* data, size_t bytes)
+    {
+      write(position_, data, bytes);
+      position_ = (position_ + (8*bytes)/bits) % pixelsPerFrame;
+    }
+
+    void seek(size_t pixelOffset)
+    {
+      position_ = pixelOffset;
+    }
+
+    void writeChunkv(const ChunkSegment* segments, size_t count)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        write(segments[i].pixelOffset, segments[i].data, segments[i].bytes);
+      }
+    }
+
+    /** \brief send the batch now **/
+    void flush()
+    {
+      if (used_ == batchHeaderBytes)
+      {
+        return;
+      }
+      uint32_t payload = used_ - batchHeaderBytes;
+      for (size_t i = 0; i < 4; i++)
+      {
+        batch_[i] = payload >> (8*i);
+        batch_[4 + i] = batchTime_ >> (8*i);
+      }
+      send(batch_, used_);
+      used_ = batchHeaderBytes;
+    }
+
+    /** \brief false once the connection was lost; chunks are dropped then **/
+    bool connected() const
+    {
+      return connected_;
+    }
+
+    /** \brief number of chunk bytes written to the display **/
+    uint64_t rawBytes() const
+    {
+      return rawBytes_;
+    }
+
+    /** \brief number of bytes sent to the viewer, including headers **/
+    uint64_t sentBytes() const
+    {
+      return sentBytes_;
+    }
+
+  private:
+    static constexpr size_t bits = color::colorRepresentation_traits<Color>::storage_bit_size;
+    static constexpr size_t pixelsPerFrame = (size_t)Width*Height;
+    static constexpr size_t frameBytes = (bits*pixelsPerFrame + 7)/8;
+
+    /** \brief largest piece of a chunk that fits into an empty batch: a multiple of 8 pixels, i.e. of bits bytes **/
+    static constexpr size_t maxPiece = ((BatchBytes - batchHeaderBytes - 32)*64/65/bits)*bits;
+
+    void write(size_t pixelOffset, const uint8_t* data, size_t bytes)
+    {
+      rawBytes_ += bytes;
+      if (pixelOffset < end_)
+      {
+        // a new frame: show the previous one completely
+        flush();
+      }
+      while (bytes)
+      {
+        size_t byteOffset = (bits*pixelOffset)/8;
+        size_t n = std::min(std::min(bytes, (size_t)maxPiece), (byteOffset < frameBytes) ? frameBytes - byteOffset : 0);
+        if (!n)
+        {
+          break;
+        }
+        if (used_ + encodedBound(n) > BatchBytes)
+        {
+          flush();
+        }
+        if (used_ == batchHeaderBytes)
+        {
+          batchTime_ = Clock::now();
+        }
+        used_ += encode(batch_ + used_, pixelOffset, data, previous_ + byteOffset, n);
+        pixelOffset += (8*n)/bits;
+        data += n;
+        bytes -= n;
+      }
+      end_ = pixelOffset;
+      if (end_ >= pixelsPerFrame)
+      {
+        flush();
+      }
+    }
+
+    void send(const uint8_t* data, size_t bytes)
+    {
+      if (connected_)
+      {
+        connected_ = transport_.send(data, bytes);
+        sentBytes_ += bytes;
+      }
+    }
+
+    Transport& transport_;
+    bool connected_;
+    size_t position_; /**< pixel offset in the frame where writeChunk() continues */
+    size_t end_; /**< pixel offset after the last write */
+    size_t used_; /**< bytes in the batch, including its header */
+    uint32_t batchTime_; /**< when the batch's first chunk was written */
+    uint32_t maxDelay_;
+    uint64_t rawBytes_;
+    uint64_t sentBytes_;
+    uint8_t batch_[BatchBytes];
+    uint8_t previous_[frameBytes]; /**< the frame as it was sent */
+};
+
+
+/** \brief Receives batches from a \ref RemoteDisplay, reconstructs the frame and measures the latency
+ * \tparam Transport the connection, e.g. a \ref Socket, with <tt>bool receive(uint8_t* data, size_t bytes)</tt>
+ * \tparam Clock the display's clock
+**/
+template <typename Transport, typename Clock = MonotonicClock>
+class Viewer
+{
+  public:
+    /** \brief wait for the display's hello message **/
+    Viewer(Transport& transport)
+      : transport_(transport), bits_(0), width_(0), height_(0), maxPayload_(0), end_(0), frames_(0), batches_(0),
+      receivedBytes_(0), rawBytes_(0)
+    {
+      uint8_t hello[helloBytes];
+      if (transport_.receive(hello, helloBytes) && (std::memcmp(hello, "SFCV", 4) == 0) && (hello[4] == version))
+      {
+        bits_ = hello[5];
+        width_ = hello[6] | (hello[7] << 8);
+        height_ = hello[8] | (hello[9] << 8);
+        uint32_t batchBytes = 0;
+        for (size_t i = 0; i < 4; i++)
+        {
+          batchBytes |= (uint32_t)hello[10 + i] << (8*i);
+        }
+        maxPayload_ = (batchBytes > batchHeaderBytes) ? batchBytes - batchHeaderBytes : 0;
+        frame_.assign((bits_*width_*height_ + 7)/8, 0);
+      }
+    }
+
+    /** \brief whether the hello message was valid **/
+    bool valid() const
+    {
+      return bits_ != 0;
+    }
+
+    /** \brief receive and apply the next batch
+     * \return false if the connection was closed or the batch is corrupt, e.g. larger than the display's
+     *         batch size
+    **/
+    bool receive()
+    {
+      uint8_t header[batchHeaderBytes];
+      if (!valid() || !transport_.receive(header, batchHeaderBytes))
+      {
+        return false;
+      }
+      uint32_t payload = 0;
+      uint32_t time = 0;
+      for (size_t i = 0; i < 4; i++)
+      {
+        payload |= (uint32_t)header[i] << (8*i);
+        time |= (uint32_t)header[4 + i] << (8*i);
+      }
+      if (payload > maxPayload_)
+      {
+        return false;
+      }
+      buffer_.resize(payload);
+      if (!transport_.receive(buffer_.data(), payload) || !apply(buffer_.data(), payload))
+      {
+        return false;
+      }
+      latency_.add(Clock::now() - time);
+      batches_++;
+      receivedBytes_ += batchHeaderBytes + payload;
+      return true;
+    }
+
+    /** \brief the frame as the display's color storage, frame offsets in buffer order **/
+    const std::vector<uint8_t>& frame() const
+    {
+      return frame_;
+    }
+
+    size_t bitsPerPixel() const {return bits_;}
+    size_t width() const {return width_;}
+    size_t height() const {return height_;}
+
+    /** \brief microseconds from writing a batch's first chunk until the batch was applied **/
+    const stats::Histogram& latency() const
+    {
+      return latency_;
+    }
+
+    /** \brief number of frames begun after the first, i.e. of writes that started before the previous one ended **/
+    uint64_t frames() const {return frames_;}
+    uint64_t batches() const {return batches_;}
+
+    /** \brief number of bytes received in batches **/
+    uint64_t receivedBytes() const {return receivedBytes_;}
+
+    /** \brief number of chunk bytes decoded **/
+    uint64_t rawBytes() const {return rawBytes_;}
+
+  private:
+    bool apply(const uint8_t* in, size_t size)
+    {
+      const uint8_t* end = in + size;
+      while (in < end)
+      {
+        size_t pixelOffset;
+        size_t bytes;
+        if (!getVarint(in, end, pixelOffset) || !getVarint(in, end, bytes))
+        {
+          return false;
+        }
+        size_t byteOffset = (bits_*pixelOffset)/8;
+        if ((byteOffset > frame_.size()) || (bytes > frame_.size() - byteOffset))
+        {
+          return false;
+        }
+        if (pixelOffset < end_)
+        {
+          frames_++;
+        }
+        end_ = pixelOffset + (8*bytes)/bits_;
+        rawBytes_ += bytes;
+        uint8_t* out = frame_.data() + byteOffset;
+        while (bytes)
+        {
+          size_t token;
+          if (!getVarint(in, end, token) || !(token >> 1) || ((token >> 1) > bytes))
+          {
+            return false;
+          }
+          size_t n = token >> 1;
+          if (token & 1)
+          {
+            if (in == end)
+            {
+              return false;
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+              out[i] ^= *in;
+            }
+            in++;
+          }
+          else
+          {
+            if ((size_t)(end - in) < n)
+            {
+              return false;
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+              out[i] ^= in[i];
+            }
+            in += n;
+          }
+          out += n;
+          bytes -= n;
+        }
+      }
+      return true;
+    }
+
+    Transport& transport_;
+    size_t bits_;
+    size_t width_;
+    size_t height_;
+    size_t maxPayload_; /**< largest batch payload the display sends, from the hello message */
+    size_t end_; /**< pixel offset after the last chunk */
+    std::vector<uint8_t> frame_;
+    std::vector<uint8_t> buffer_;
+    stats::Histogram latency_;
+    uint64_t frames_;
+    uint64_t batches_;
+    uint64_t receivedBytes_;
+    uint64_t rawBytes_;
+};
+
+} // namespace remote
+
+
+/** \brief a remote display is addressable and vectored **/
+template <typename Color, uint16_t Width, uint16_t Height, typename Transport, typename Clock, size_t BatchBytes>
+struct display_traits<remote::RemoteDisplay<Color, Width, Height, Transport, Clock, BatchBytes> >
+  : public default_display_traits<remote::RemoteDisplay<Color, Width, Height, Transport, Clock, BatchBytes> >
+{
+  static constexpr bool addressable = true;
+  static constexpr bool vectored = true;
+};
+
+#endif // SFC_OUTPUT_REMOTE_H
@@ -0,0 +1,246 @@
+#ifndef SFC_OUTPUT_SCHEDULER_H
+#define SFC_OUTPUT_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#include "fpsLimiter.h"
+
+/** \file scheduler.h Driving several displays from one loop
+
+ * Every OutputManager sends one chunk (or advances one page) per update(), and only while its display is
+ * ready. With several displays, polling them in a fixed order wastes bus time and lets a slow or busy panel
+ * delay the others. A \ref Scheduler drives up to MaxOutputs output managers instead:
+ * - Outputs with the same bus id share a bus, e.g. one SPI bus with a chip select per panel. Only one
+ *   transfer is in flight on a bus at a time: a bus is free when all its displays are ready, and then one
+ *   of them gets the next chunk.
+ * - Outputs on different buses are served in the same update(), so their DMA transfers run in parallel.
+ * - Among the outputs of a bus, the chunks are shared in proportion to the outputs' priorities (smooth
+ *   weighted round robin), so no panel starves.
+ * - An output with a target frame rate is not served between frames until its next frame is due
+ *   (see \ref FpsLimiter), which leaves the bus to the others.
+ *
+ * \code
+ * Scheduler<MicrosClock> scheduler;
+ * scheduler.add(mainCanvas.outputDispatcher(), 0, 3);     // bus 0, priority 3, unlimited frame rate
+ * scheduler.add(statusCanvas.outputDispatcher(), 0, 1, 10); // bus 0, priority 1, 10 fps
+ * scheduler.add(sideCanvas.outputDispatcher(), 1);         // own bus
+ * while (true)
+ * {
+ *   // draw...
+ *   scheduler.update();
+ * }
+ * \endcode
+**/
+
+/** \brief Type-erased interface of an output that a \ref Scheduler drives **/
+class ScheduledOutput
+{
+  public:
+    /** \brief let the display do its work, and tell whether it is ready for the next chunk **/
+    virtual bool ready() = 0;
+
+    /** \brief whether the current frame was sent, see OutputManager::frameSent() **/
+    virtual bool frameSent() const = 0;
+
+    /** \brief send the next chunk, or start the next page or frame, see OutputManager::update() **/
+    virtual void update() = 0;
+
+  protected:
+    ~ScheduledOutput()
+    {
+    }
+};
+
+
+/** \brief ScheduledOutput for an OutputManager (or anything with the same update(), frameSent() and display())
+ * \tparam Manager the output manager type
+**/
+template <typename Manager>
+class ScheduledOutputT : public ScheduledOutput
+{
+  public:
+    ScheduledOutputT(Manager& manager)
+      : manager_(manager)
+    {
+    }
+
+    bool ready()
+    {
+      manager_.display().update();
+      return manager_.display().ready();
+    }
+
+    bool frameSent() const
+    {
+      return manager_.frameSent();
+    }
+
+    void update()
+    {
+      manager_.update();
+    }
+
+  private:
+    Manager& manager_;
+};
+
+
+/** \brief Drives several output managers over shared or independent buses, see \ref scheduler.h
+ * \tparam Clock the clock class for frame rate limits, see \ref FpsLimiter
+ * \tparam MaxOutputs maximum number of outputs
+**/
+template <typename Clock, size_t MaxOutputs = 4>
+class Scheduler
+{
+  public:
+    Scheduler()
+      : count_(0)
+    {
+    }
+
+    /** \brief add an output
+     * \param manager the output manager, e.g. Canvas::outputDispatcher(). It must outlive the scheduler.
+     * \param bus id of the bus the display is connected to; outputs with the same id share the bus
+     * \param priority share of the bus relative to the other outputs on it, at least 1
+     * \param fps target frame rate, 0 for no limit
+     * \return false if the scheduler is full
+    **/
+    template <typename Manager>
+    bool add(Manager& manager, uint8_t bus = 0, unsigned priority = 1, unsigned fps = 0)
+    {
+      static_assert(sizeof(ScheduledOutputT<Manager>) <= sizeof(storage_t), "Scheduler: unexpected size of ScheduledOutputT");
+      if (count_ == MaxOutputs)
+      {
+        return false;
+      }
+      Entry& entry = entries_[count_++];
+      entry.output = ::new (static_cast<void*>(&entry.storage)) ScheduledOutputT<Manager>(manager);
+      entry.bus = bus;
+      entry.priority = priority ? priority : 1;
+      entry.credit = 0;
+      entry.limiter.setFps(fps);
+      return true;
+    }
+
+    /** \brief number of outputs **/
+    size_t size() const
+    {
+      return count_;
+    }
+
+    /** \brief change an output's target frame rate, 0 for no limit
+     * \param output index of the output, in the order they were added
+    **/
+    void setFps(size_t output, unsigned fps)
+    {
+      entries_[output].limiter.setFps(fps);
+    }
+
+    /** \brief change an output's priority, at least 1
+     * \param output index of the output, in the order they were added
+    **/
+    void setPriority(size_t output, unsigned priority)
+    {
+      entries_[output].priority = priority ? priority : 1;
+    }
+
+    /** \brief serve every free bus once: each gets one chunk, page or frame step of one of its outputs
+     * \return number of outputs that were served
+    **/
+    size_t update()
+    {
+      uint32_t now = Clock::now();
+      bool ready[MaxOutputs];
+      for (size_t i = 0; i < count_; i++)
+      {
+        ready[i] = entries_[i].output->ready();
+      }
+      size_t served = 0;
+      for (size_t i = 0; i < count_; i++)
+      {
+        if (firstOnBus(i))
+        {
+          served += serve(entries_[i].bus, ready, now);
+        }
+      }
+      return served;
+    }
+
+  private:
+    /** \brief storage for a ScheduledOutputT, which has the same size for every Manager **/
+    struct any_manager;
+    typedef typename std::aligned_storage<sizeof(ScheduledOutputT<any_manager>), alignof(ScheduledOutputT<any_manager>)>::type storage_t;
+
+    struct Entry
+    {
+      storage_t storage;
+      ScheduledOutput* output;
+      uint8_t bus;
+      unsigned priority;
+      int credit; /**< smooth weighted round robin credit */
+      FpsLimiter<Clock> limiter;
+    };
+
+    bool firstOnBus(size_t i) const
+    {
+      for (size_t j = 0; j < i; j++)
+      {
+        if (entries_[j].bus == entries_[i].bus)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    /** \brief give the next step on a bus to the eligible output with the highest credit
+     * \return 1 if an output was served, 0 if the bus was busy or no output had work
+    **/
+    size_t serve(uint8_t bus, const bool* ready, uint32_t now)
+    {
+      for (size_t i = 0; i < count_; i++)
+      {
+        if ((entries_[i].bus == bus) && !ready[i])
+        {
+          // a transfer is in flight on this bus
+          return 0;
+        }
+      }
+      Entry* selected = 0;
+      int total = 0;
+      for (size_t i = 0; i < count_; i++)
+      {
+        Entry& entry = entries_[i];
+        if ((entry.bus != bus) || (entry.output->frameSent() && !entry.limiter.due(now)))
+        {
+          continue;
+        }
+        entry.credit += entry.priority;
+        total += entry.priority;
+        if (!selected || (entry.credit > selected->credit))
+        {
+          selected = &entry;
+        }
+      }
+      if (!selected)
+      {
+        return 0;
+      }
+      selected->credit -= total;
+      if (selected->output->frameSent())
+      {
+        // the display is ready, so this update starts a new frame
+        selected->limiter.begin(now);
+      }
+      selected->output->update();
+      return 1;
+    }
+
+    Entry entries_[MaxOutputs];
+    size_t count_;
+};
+
+#endif // SFC_OUTPUT_SCHEDULER_H
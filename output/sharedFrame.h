@@ -0,0 +1,507 @@
+#ifndef SFC_OUTPUT_SHAREDFRAME_H
+#define SFC_OUTPUT_SHAREDFRAME_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "../color/colorRepresentation.h"
+#include "../geo/bbx.h"
+#include "pageRenderer.h"
+
+/** \file sharedFrame.h A framebuffer in shared memory that several processes draw into (POSIX)
+
+ * Several processes (e.g. a status bar, the main application and an alert overlay) can share one display:
+ * a \ref shm::Framebuffer is mapped by all of them (\ref shm::Mapping). Every producer claims a rectangular
+ * region and draws into it with a \ref shm::Producer, and one output process copies what was published
+ * and streams the changed rows through its OutputManager (\ref shm::Output):
+ * \code
+ * typedef shm::Framebuffer<color::RGB565, 320, 240> frame_t;
+ *
+ * // producer
+ * shm::Mapping<frame_t> mapping = shm::Mapping<frame_t>::open("/panel");
+ * shm::Producer<frame_t> bar(*mapping, frame_t::bbx_t(frame_t::point_t(0, 0), frame_t::point_t(319, 15)));
+ * bar.begin();
+ * bar.fill(bar.area(), color::RGB565(0, 0, 64));
+ * bar.end();
+ *
+ * // output process
+ * shm::Mapping<frame_t> mapping = shm::Mapping<frame_t>::create("/panel");
+ * shm::Output<canvas_t::outputDispatcher_t, frame_t> output(canvas.outputDispatcher(), *mapping);
+ * while (true)
+ * {
+ *   output.poll();
+ *   canvas.update();
+ * }
+ * \endcode
+ * There is no global lock. Every region has its own sequence counter (a seqlock): the producer makes it
+ * odd while it draws and even when it is done, and the output process copies a region only if the counter
+ * was even and didn't change during the copy; otherwise it tries again at the next poll(). So producers
+ * never wait for each other or for the output, and the output never waits for a producer. Claiming is
+ * lock-free as well: two producers that claim overlapping regions at the same time may both fail and retry.
+ *
+ * Like any seqlock, the copy reads pixels that may be written at the same time, and discards the copy if
+ * they were; the pixels are plain memory, not atomics. The regions of different producers don't share
+ * pixels, so the colors must have whole bytes.
+**/
+
+/** \brief Shared-memory framebuffer for several producer processes, see \ref sharedFrame.h **/
+namespace shm
+{
+
+/** \brief A framebuffer with claimable regions, to be placed in shared memory
+ * \tparam Color the color type, with a whole number of bytes
+ * \tparam Width, Height the size in pixels
+ * \tparam MaxRegions maximum number of claimed regions
+**/
+template <typename Color, uint16_t Width, uint16_t Height, size_t MaxRegions = 8>
+class Framebuffer
+{
+  static_assert(color::colorRepresentation_traits<Color>::storage_bit_size % 8 == 0,
+                "shm::Framebuffer: regions must not share bytes, so colors must have whole bytes");
+  static_assert((ATOMIC_INT_LOCK_FREE == 2) && (ATOMIC_SHORT_LOCK_FREE == 2), "shm::Framebuffer: lock-free atomics are required in shared memory");
+
+  public:
+    typedef Color color_t;
+    typedef uint16_t coordinate_t;
+    typedef Point<Framebuffer> point_t;
+    typedef Bbx<Framebuffer> bbx_t;
+    static constexpr coordinate_t width = Width;
+    static constexpr coordinate_t height = Height;
+    static constexpr size_t regions = MaxRegions;
+
+    /** \brief states of a region slot **/
+    enum state : uint32_t
+    {
+      vacant, /**< not claimed */
+      reserved, /**< being claimed, its area is not set yet */
+      checking, /**< being claimed, its area is set and checked against the others */
+      claimed /**< owned by a producer */
+    };
+
+    Framebuffer()
+    {
+      for (size_t i = 0; i < MaxRegions; i++)
+      {
+        Region& r = regions_[i];
+        r.state.store(vacant, std::memory_order_relaxed);
+        r.generation.store(0, std::memory_order_relaxed);
+        r.sequence.store(0, std::memory_order_relaxed);
+        for (size_t j = 0; j < 4; j++)
+        {
+          r.area[j].store(0, std::memory_order_relaxed);
+        }
+      }
+      std::memset(static_cast<void*>(pixels_), 0, sizeof(pixels_));
+    }
+
+    /** \brief claim a region that doesn't overlap any claimed one
+     * \return the region's index, or -1 if the area overlaps another region, is being claimed at the same
+     *         time as an overlapping one (retry), or no slot is free
+    **/
+    int claim(const bbx_t& area)
+    {
+      bbx_t clipped = area.intersect(bbx_t(point_t(0, 0), point_t(Width - 1, Height - 1)));
+      if (!clipped.valid())
+      {
+        return -1;
+      }
+      for (size_t i = 0; i < MaxRegions; i++)
+      {
+        Region& r = regions_[i];
+        uint32_t expected = vacant;
+        if (!r.state.compare_exchange_strong(expected, reserved))
+        {
+          continue;
+        }
+        r.area[0].store(clipped.left(), std::memory_order_relaxed);
+        r.area[1].store(clipped.top(), std::memory_order_relaxed);
+        r.area[2].store(clipped.right(), std::memory_order_relaxed);
+        r.area[3].store(clipped.bottom(), std::memory_order_relaxed);
+        // sequentially consistent: of two producers that check at the same time, at least one sees the other
+        r.state.store(checking);
+        for (size_t j = 0; j < MaxRegions; j++)
+        {
+          if ((j != i) && (regions_[j].state.load() >= checking) && area_(j).intersect(clipped).valid())
+          {
+            r.state.store(vacant);
+            return -1;
+          }
+        }
+        r.generation.store(r.generation.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        // a previous producer may have died while drawing and left the counter odd
+        uint32_t sequence = r.sequence.load(std::memory_order_relaxed);
+        r.sequence.store((sequence + 1) & ~(uint32_t)1, std::memory_order_relaxed);
+        r.state.store(claimed, std::memory_order_release);
+        return i;
+      }
+      return -1;
+    }
+
+    /** \brief release a region; its pixels stay as they are. This may also be called for the region of a
+     * producer that died, even while it was drawing.
+    **/
+    void release(int region)
+    {
+      regions_[region].state.store(vacant, std::memory_order_release);
+    }
+
+    /** \brief state of a region slot **/
+    state regionState(size_t region) const
+    {
+      return (state)regions_[region].state.load(std::memory_order_acquire);
+    }
+
+    /** \brief number of times a region slot was claimed **/
+    uint32_t generation(size_t region) const
+    {
+      return regions_[region].generation.load(std::memory_order_relaxed);
+    }
+
+    /** \brief area of a region, valid while it is claimed **/
+    bbx_t area(size_t region) const
+    {
+      return area_(region);
+    }
+
+    /** \brief the region's sequence counter, odd while its producer draws **/
+    std::atomic<uint32_t>& sequence(size_t region)
+    {
+      return regions_[region].sequence;
+    }
+
+    /** \brief first pixel of a row **/
+    color_t* row(coordinate_t y)
+    {
+      return pixels_ + (size_t)y*Width;
+    }
+
+    const color_t* row(coordinate_t y) const
+    {
+      return pixels_ + (size_t)y*Width;
+    }
+
+  private:
+    struct Region
+    {
+      std::atomic<uint32_t> state;
+      std::atomic<uint32_t> generation;
+      std::atomic<uint32_t> sequence;
+      std::atomic<uint16_t> area[4]; /**< left, top, right, bottom */
+    };
+
+    bbx_t area_(size_t region) const
+    {
+      const Region& r = regions_[region];
+      return bbx_t(point_t(r.area[0].load(std::memory_order_relaxed), r.area[1].load(std::memory_order_relaxed)),
+                   point_t(r.area[2].load(std::memory_order_relaxed), r.area[3].load(std::memory_order_relaxed)));
+    }
+
+    Region regions_[MaxRegions];
+    color_t pixels_[(size_t)Width*Height];
+};
+
+
+/** \brief A shared memory object that holds a T, mapped into this process (POSIX shm_open) **/
+template <typename T>
+class Mapping
+{
+  public:
+    Mapping()
+      : object_(0)
+    {
+    }
+
+    Mapping(Mapping&& other)
+      : object_(other.object_)
+    {
+      other.object_ = 0;
+    }
+
+    Mapping& operator=(Mapping&& other)
+    {
+      std::swap(object_, other.object_);
+      return *this;
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    ~Mapping()
+    {
+      if (object_)
+      {
+        ::munmap(object_, sizeof(T));
+      }
+    }
+
+    /** \brief create (or recreate) the object and construct a T in it
+     * \param name the object's name, e.g. "/panel"
+    **/
+    static Mapping create(const char* name)
+    {
+      Mapping m;
+      void* p = map(name, O_RDWR | O_CREAT | O_TRUNC);
+      if (p)
+      {
+        m.object_ = ::new (p) T();
+      }
+      return m;
+    }
+
+    /** \brief map an object created by another process **/
+    static Mapping open(const char* name)
+    {
+      Mapping m;
+      m.object_ = static_cast<T*>(map(name, O_RDWR));
+      return m;
+    }
+
+    /** \brief remove the object's name; processes that mapped it keep it **/
+    static void remove(const char* name)
+    {
+      ::shm_unlink(name);
+    }
+
+    bool valid() const
+    {
+      return object_ != 0;
+    }
+
+    T& operator*() const
+    {
+      return *object_;
+    }
+
+    T* operator->() const
+    {
+      return object_;
+    }
+
+  private:
+    static void* map(const char* name, int flags)
+    {
+      int fd = ::shm_open(name, flags, 0600);
+      if (fd < 0)
+      {
+        return 0;
+      }
+      void* p = 0;
+      if (!(flags & O_CREAT) || (::ftruncate(fd, sizeof(T)) == 0))
+      {
+        p = ::mmap(0, sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      }
+      ::close(fd);
+      return (p == MAP_FAILED) ? 0 : p;
+    }
+
+    T* object_;
+};
+
+
+/** \brief Draws into a claimed region of a \ref Framebuffer; the region is released when it is destroyed.
+ * Drawing happens between begin() and end(), which publish it to the output.
+ * \tparam Framebuffer the framebuffer type
+**/
+template <typename Framebuffer>
+class Producer
+{
+  public:
+    typedef typename Framebuffer::color_t color_t;
+    typedef typename Framebuffer::coordinate_t coordinate_t;
+    typedef typename Framebuffer::bbx_t bbx_t;
+
+    /** \brief claim a region, see Framebuffer::claim() **/
+    Producer(Framebuffer& framebuffer, const bbx_t& area)
+      : framebuffer_(framebuffer), region_(framebuffer.claim(area)), sequence_(0)
+    {
+      if (valid())
+      {
+        area_ = framebuffer_.area(region_);
+        sequence_ = framebuffer_.sequence(region_).load(std::memory_order_relaxed);
+      }
+    }
+
+    ~Producer()
+    {
+      if (valid())
+      {
+        framebuffer_.release(region_);
+      }
+    }
+
+    Producer(const Producer&) = delete;
+    Producer& operator=(const Producer&) = delete;
+
+    /** \brief whether the region was claimed **/
+    bool valid() const
+    {
+      return region_ >= 0;
+    }
+
+    /** \brief the claimed area, clipped to the display **/
+    const bbx_t& area() const
+    {
+      return area_;
+    }
+
+    /** \brief start drawing: the output doesn't copy the region until end() **/
+    void begin()
+    {
+      framebuffer_.sequence(region_).store(++sequence_, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    /** \brief publish what was drawn since begin() **/
+    void end()
+    {
+      framebuffer_.sequence(region_).store(++sequence_, std::memory_order_release);
+    }
+
+    /** \brief set a pixel; ignored outside the area **/
+    void set(coordinate_t x, coordinate_t y, const color_t& c)
+    {
+      if ((x >= area_.left()) && (x <= area_.right()) && (y >= area_.top()) && (y <= area_.bottom()))
+      {
+        framebuffer_.row(y)[x] = c;
+      }
+    }
+
+    /** \brief fill a box, clipped to the area **/
+    void fill(const bbx_t& box, const color_t& c)
+    {
+      bbx_t clipped = box.intersect(area_);
+      if (!clipped.valid())
+      {
+        return;
+      }
+      for (size_t y = clipped.top(); y <= clipped.bottom(); y++)
+      {
+        color_t* row = framebuffer_.row(y);
+        std::fill(row + clipped.left(), row + clipped.right() + 1, c);
+      }
+    }
+
+  private:
+    Framebuffer& framebuffer_;
+    int region_;
+    bbx_t area_;
+    uint32_t sequence_; /**< the region's sequence counter, only this producer changes it */
+};
+
+
+/** \brief Copies the regions the producers published into a local frame and sends them through an
+ * output manager, whose \ref PageRenderer it is
+ *
+ * Only the rows of regions that changed are marked (see OutputManager::invalidate(const bbx_t&)), so
+ * with damage_tracking (see \ref output_traits) only those pages are sent.
+ * \tparam Manager the output manager type, e.g. Canvas::outputDispatcher_t
+ * \tparam Framebuffer the framebuffer type, of the display's size
+**/
+template <typename Manager, typename Framebuffer>
+class Output : public PageRenderer<typename Manager::buffer_t>
+{
+  public:
+    typedef typename Manager::buffer_t buffer_t;
+    typedef typename Manager::bbx_t bbx_t;
+    typedef typename buffer_t::point_t point_t;
+    typedef typename Framebuffer::color_t color_t;
+
+    static_assert((Framebuffer::width == buffer_t::width) && (Framebuffer::height == buffer_t::height),
+                  "shm::Output: the framebuffer must have the display's size");
+
+    /** \brief install the output as the manager's renderer; the first frame is sent completely **/
+    Output(Manager& manager, Framebuffer& framebuffer)
+      : manager_(manager), framebuffer_(framebuffer), frame_((size_t)Framebuffer::width*Framebuffer::height),
+      copy_((size_t)Framebuffer::width*Framebuffer::height)
+    {
+      for (size_t i = 0; i < Framebuffer::regions; i++)
+      {
+        generation_[i] = framebuffer_.generation(i) - 1;
+        sequence_[i] = 0;
+      }
+      manager_.setRenderer(this);
+      manager_.invalidate(bbx_t(point_t(0, 0), point_t(Framebuffer::width - 1, Framebuffer::height - 1)));
+    }
+
+    ~Output()
+    {
+      manager_.setRenderer(0);
+    }
+
+    /** \brief copy the regions that were published since the last poll and mark their rows. Never waits:
+     * a region that is being drawn, or changed while it was copied, is copied at a later poll.
+     * \return number of regions copied
+    **/
+    size_t poll()
+    {
+      size_t copied = 0;
+      for (size_t i = 0; i < Framebuffer::regions; i++)
+      {
+        if (framebuffer_.regionState(i) != Framebuffer::claimed)
+        {
+          continue;
+        }
+        uint32_t generation = framebuffer_.generation(i);
+        std::atomic<uint32_t>& sequence = framebuffer_.sequence(i);
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if ((before & 1) || ((generation == generation_[i]) && (before == sequence_[i])))
+        {
+          continue;
+        }
+        typename Framebuffer::bbx_t area = framebuffer_.area(i);
+        size_t width = area.right() - area.left() + 1;
+        for (size_t y = area.top(); y <= area.bottom(); y++)
+        {
+          std::memcpy(static_cast<void*>(&copy_[y*Framebuffer::width + area.left()]),
+                      framebuffer_.row(y) + area.left(), width*sizeof(color_t));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((sequence.load(std::memory_order_relaxed) != before) || (framebuffer_.generation(i) != generation)
+            || (framebuffer_.regionState(i) != Framebuffer::claimed))
+        {
+          // torn: the producer drew or released the region meanwhile
+          continue;
+        }
+        for (size_t y = area.top(); y <= area.bottom(); y++)
+        {
+          size_t first = y*Framebuffer::width + area.left();
+          std::copy(copy_.begin() + first, copy_.begin() + first + width, frame_.begin() + first);
+        }
+        generation_[i] = generation;
+        sequence_[i] = before;
+        manager_.invalidate(bbx_t(point_t(area.left(), area.top()), point_t(area.right(), area.bottom())));
+        copied++;
+      }
+      return copied;
+    }
+
+    void render(buffer_t& buffer)
+    {
+      buffer.generate(buffer.bbx(),
+                      [this](size_t x, size_t y)
+                      {
+                        return typename buffer_t::color_t(frame_[y*Framebuffer::width + x]);
+                      });
+    }
+
+  private:
+    Manager& manager_;
+    Framebuffer& framebuffer_;
+    std::vector<color_t> frame_; /**< what was copied, the content of the display */
+    std::vector<color_t> copy_; /**< regions being copied, until they are validated */
+    uint32_t generation_[Framebuffer::regions]; /**< claim of every region slot that was copied last */
+    uint32_t sequence_[Framebuffer::regions]; /**< sequence counter of every region when it was copied last */
+};
+
+} // namespace shm
+
+#endif // SFC_OUTPUT_SHAREDFRAME_H
@@ -0,0 +1,276 @@
+#ifndef SFC_OUTPUT_STATISTICS_H
+#define SFC_OUTPUT_STATISTICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "trace.h"
+
+/** \file statistics.h Always-on latency histograms and throughput of the output path
+
+ * \ref stats::Collector is a tracer (see \ref trace.h) that keeps a log-bucketed histogram of the
+ * durations of every kind of span, e.g. frame times, page composition, chunk conversion and the time the
+ * display was busy, and the bytes, pixels and frames sent in a sliding window. Its memory is fixed.
+ *
+ * The OutputManager's loop is the only writer, and it only uses relaxed atomic loads and stores, no locks
+ * and no read-modify-write instructions. Another thread, e.g. a monitor that raises an alert when a panel's
+ * frame rate drops, can read the statistics at any time; what it reads may lag behind by one update.
+ * \code
+ * template <>
+ * struct output_traits<MyDisplay, MyFrontend> : public default_output_traits<MyDisplay, MyFrontend>
+ * {
+ *   typedef stats::Collector<MicrosClock> trace_t;
+ * };
+ * ...
+ * if (canvas.tracer().framesPerSecond() < 20)
+ * {
+ *   // alert
+ * }
+ * uint32_t p99 = canvas.tracer().histogram(trace::frame).quantile(99);
+ * \endcode
+**/
+
+/** \brief Statistics of the output path, see \ref statistics.h **/
+namespace stats
+{
+
+/** \brief A histogram of durations with power of two buckets
+ *
+ * Bucket 0 counts zero, bucket b > 0 counts values in [2^(b-1), 2^b).
+**/
+class Histogram
+{
+  public:
+    static constexpr size_t buckets = 33;
+
+    Histogram()
+      : count_(0), max_(0)
+    {
+      for (size_t b = 0; b < buckets; b++)
+      {
+        counts_[b].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    /** \brief add a value. Only one thread may add values. **/
+    void add(uint32_t value)
+    {
+      std::atomic<uint32_t>& c = counts_[bucket(value)];
+      c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      if (value > max_.load(std::memory_order_relaxed))
+      {
+        max_.store(value, std::memory_order_relaxed);
+      }
+    }
+
+    /** \brief number of values **/
+    uint32_t count() const
+    {
+      return count_.load(std::memory_order_relaxed);
+    }
+
+    /** \brief largest value **/
+    uint32_t max() const
+    {
+      return max_.load(std::memory_order_relaxed);
+    }
+
+    /** \brief number of values in a bucket **/
+    uint32_t count(size_t bucket) const
+    {
+      return counts_[bucket].load(std::memory_order_relaxed);
+    }
+
+    /** \brief largest value that falls into a bucket **/
+    static uint32_t limit(size_t bucket)
+    {
+      return bucket ? (uint32_t)(((uint64_t)1 << bucket) - 1) : 0;
+    }
+
+    /** \brief bucket of a value **/
+    static size_t bucket(uint32_t value)
+    {
+      size_t b = 0;
+      while (value)
+      {
+        value >>= 1;
+        b++;
+      }
+      return b;
+    }
+
+    /** \brief an upper bound for a quantile, i.e. the limit of the bucket that contains it (or the largest value)
+     * \param percent the quantile in percent, e.g. 50 for the median or 99
+    **/
+    uint32_t quantile(unsigned percent) const
+    {
+      uint64_t target = ((uint64_t)count()*percent + 99)/100;
+      uint64_t sum = 0;
+      for (size_t b = 0; b < buckets; b++)
+      {
+        sum += count(b);
+        if (sum >= target)
+        {
+          return (limit(b) < max()) ? limit(b) : max();
+        }
+      }
+      return max();
+    }
+
+  private:
+    std::atomic<uint32_t> counts_[buckets];
+    std::atomic<uint32_t> count_;
+    std::atomic<uint32_t> max_;
+};
+
+
+/** \brief Sums of bytes, pixels and frames over a sliding window of time
+ *
+ * The window is divided into Slots slots; a slot is reset when it is reused, and a rate is computed
+ * over the slots that are still in the window, including the current, partial one.
+ * \tparam Clock a class with <tt>static uint32_t now()</tt> that returns microseconds
+ * \tparam Window length of the window in microseconds
+ * \tparam Slots number of slots
+**/
+template <typename Clock, uint32_t Window, size_t Slots>
+class Throughput
+{
+  static_assert((Slots > 1) && (Window >= Slots), "stats::Throughput: at least two slots of at least 1 us are required");
+
+  public:
+    /** \brief length of a slot in microseconds **/
+    static constexpr uint32_t slot = Window/Slots;
+
+    enum quantity
+    {
+      bytes,
+      pixels,
+      frames,
+      quantities
+    };
+
+    Throughput()
+    {
+      for (size_t s = 0; s < Slots; s++)
+      {
+        epoch_[s].store(0xFFFFFFFF, std::memory_order_relaxed);
+        for (size_t q = 0; q < quantities; q++)
+        {
+          sums_[s][q].store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+
+    /** \brief add to a quantity now. Only one thread may add. **/
+    void add(quantity q, uint32_t n)
+    {
+      uint32_t epoch = Clock::now()/slot;
+      size_t s = epoch % Slots;
+      if (epoch_[s].load(std::memory_order_relaxed) != epoch)
+      {
+        for (size_t i = 0; i < quantities; i++)
+        {
+          sums_[s][i].store(0, std::memory_order_relaxed);
+        }
+        epoch_[s].store(epoch, std::memory_order_relaxed);
+      }
+      std::atomic<uint32_t>& sum = sums_[s][q];
+      sum.store(sum.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /** \brief rate of a quantity per second over the window **/
+    uint32_t perSecond(quantity q) const
+    {
+      uint32_t now = Clock::now();
+      uint32_t epoch = now/slot;
+      uint64_t sum = 0;
+      for (size_t s = 0; s < Slots; s++)
+      {
+        if ((uint32_t)(epoch - epoch_[s].load(std::memory_order_relaxed)) < Slots)
+        {
+          sum += sums_[s][q].load(std::memory_order_relaxed);
+        }
+      }
+      uint64_t elapsed = (uint64_t)(Slots - 1)*slot + now % slot;
+      return elapsed ? (uint32_t)(sum*1000000/elapsed) : 0;
+    }
+
+  private:
+    std::atomic<uint32_t> epoch_[Slots]; /**< the slot number (time/slot) a slot holds */
+    std::atomic<uint32_t> sums_[Slots][quantities];
+};
+
+
+/** \brief A tracer that collects histograms of span durations and the throughput of the output
+ * \tparam Clock a class with <tt>static uint32_t now()</tt> that returns microseconds, see \ref AdaptiveChunks
+ * \tparam Window length of the throughput window in microseconds
+ * \tparam Slots number of slots of the throughput window
+**/
+template <typename Clock, uint32_t Window = 1000000, size_t Slots = 8>
+class Collector
+{
+  public:
+    typedef Throughput<Clock, Window, Slots> throughput_t;
+
+    void begin(trace::event e)
+    {
+      spans_.begin(e);
+    }
+
+    void end(trace::event e, uint32_t, size_t, size_t)
+    {
+      uint32_t start;
+      uint32_t duration;
+      if (spans_.end(e, start, duration))
+      {
+        histograms_[e].add(duration);
+        if (e == trace::frame)
+        {
+          throughput_.add(throughput_t::frames, 1);
+        }
+      }
+    }
+
+    void sent(size_t bytes, size_t pixels)
+    {
+      throughput_.add(throughput_t::bytes, bytes);
+      throughput_.add(throughput_t::pixels, pixels);
+    }
+
+    /** \brief durations of a kind of span in microseconds, e.g. trace::frame for frame times, trace::convert for
+     * chunk conversion or trace::wait for the time the display was busy
+    **/
+    const Histogram& histogram(trace::event e) const
+    {
+      return histograms_[e];
+    }
+
+    /** \brief bytes sent per second, over the window **/
+    uint32_t bytesPerSecond() const
+    {
+      return throughput_.perSecond(throughput_t::bytes);
+    }
+
+    /** \brief pixels sent per second, over the window **/
+    uint32_t pixelsPerSecond() const
+    {
+      return throughput_.perSecond(throughput_t::pixels);
+    }
+
+    /** \brief frames completed per second, over the window **/
+    uint32_t framesPerSecond() const
+    {
+      return throughput_.perSecond(throughput_t::frames);
+    }
+
+  private:
+    trace::Spans<Clock> spans_;
+    Histogram histograms_[trace::events];
+    throughput_t throughput_;
+};
+
+} // namespace stats
+
+#endif // SFC_OUTPUT_STATISTICS_H
@@ -0,0 +1,296 @@
+#ifndef SFC_OUTPUT_TRACE_H
+#define SFC_OUTPUT_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/** \file trace.h Timeline tracing of the output path
+
+ * An OutputManager reports what it spends its time on to a tracer, selected as \c trace_t in
+ * \ref output_traits: the application's drawing between two updates, the conversion of chunks
+ * (ColorBuffer::makeChunk(), including dithering and wire encoding), writes to the display, waiting for
+ * the display, the composition of a page by a \ref PageRenderer, and pages and frames as a whole.
+ *
+ * The default tracer, \ref trace::none, has empty inline functions, so tracing compiles to nothing and
+ * the hooks can stay in production builds. \ref trace::Recorder keeps the last events in a ring and
+ * exports them in the Chrome trace event format, which chrome://tracing and Perfetto display as a timeline:
+ * \code
+ * template <>
+ * struct output_traits<MyDisplay, MyFrontend> : public default_output_traits<MyDisplay, MyFrontend>
+ * {
+ *   typedef trace::Recorder<MicrosClock, 1024> trace_t;
+ * };
+ * ...
+ * std::ofstream file("frame.json");
+ * canvas.outputDispatcher().tracer().writeChromeTrace(file);
+ * \endcode
+ * A tracer provides
+ * \code
+ * void begin(trace::event e);                                           // a span starts now
+ * void end(trace::event e, uint32_t frame, size_t page, size_t chunk);  // it ends now; ignored if it didn't start
+ * void sent(size_t bytes, size_t pixels);                               // a write to the display was made
+ * \endcode
+ * \ref trace::tee combines two tracers, e.g. a recorder and the statistics of \ref statistics.h.
+**/
+
+/** \brief Tracers for the output path, see \ref trace.h **/
+namespace trace
+{
+
+/** \brief kinds of spans, each shown as its own track **/
+enum event
+{
+  frame, /**< a frame, from its start until its last chunk was sent */
+  page, /**< a page that is sent, from its start until its last chunk was sent */
+  render, /**< the composition of a page by the output manager's PageRenderer */
+  draw, /**< the application's drawing, i.e. the time between two OutputManager::update() calls */
+  convert, /**< the conversion of a chunk, ColorBuffer::makeChunk() */
+  write, /**< Display::writeChunk() or Display::writeChunkv() */
+  wait, /**< the display was busy */
+  events /**< number of event kinds */
+};
+
+
+/** \brief name of an event kind, as shown in the trace **/
+inline const char* name(event e)
+{
+  static const char* const names[events] = {"frame", "page", "render", "draw", "convert", "write", "wait"};
+  return names[e];
+}
+
+
+/** \brief The default tracer, which does nothing **/
+struct none
+{
+  void begin(event)
+  {
+  }
+
+  void end(event, uint32_t, size_t, size_t)
+  {
+  }
+
+  void sent(size_t, size_t)
+  {
+  }
+};
+
+
+/** \brief Start times of the open spans, for tracers that measure durations
+ * \tparam Clock a class with <tt>static uint32_t now()</tt> that returns microseconds
+**/
+template <typename Clock>
+class Spans
+{
+  public:
+    Spans()
+    {
+      for (size_t i = 0; i < events; i++)
+      {
+        open_[i] = false;
+      }
+    }
+
+    /** \brief start a span, unless one of this kind is open **/
+    void begin(event e)
+    {
+      if (!open_[e])
+      {
+        start_[e] = Clock::now();
+        open_[e] = true;
+      }
+    }
+
+    /** \brief end a span
+     * \param e the kind of span
+     * \param start returns when the span started
+     * \param duration returns the span's duration
+     * \return false if no span of this kind was open
+    **/
+    bool end(event e, uint32_t& start, uint32_t& duration)
+    {
+      if (!open_[e])
+      {
+        return false;
+      }
+      open_[e] = false;
+      start = start_[e];
+      duration = Clock::now() - start;
+      return true;
+    }
+
+  private:
+    uint32_t start_[events]; /**< start of the open span of every kind */
+    bool open_[events];
+};
+
+
+/** \brief A tracer that forwards everything to two tracers **/
+template <typename First, typename Second>
+struct tee
+{
+  void begin(event e)
+  {
+    first.begin(e);
+    second.begin(e);
+  }
+
+  void end(event e, uint32_t frame, size_t page, size_t chunk)
+  {
+    first.end(e, frame, page, chunk);
+    second.end(e, frame, page, chunk);
+  }
+
+  void sent(size_t bytes, size_t pixels)
+  {
+    first.sent(bytes, pixels);
+    second.sent(bytes, pixels);
+  }
+
+  First first;
+  Second second;
+};
+
+
+/** \brief A tracer that records the last Capacity spans in a ring
+ *
+ * The OutputManager's loop is the only writer. Every word of the ring is a relaxed atomic and the write
+ * position is published with release semantics, so another thread (e.g. a debug console) can export the
+ * ring at any time without locking the render loop; spans that are overwritten while they are exported
+ * are dropped.
+ * \tparam Clock a class with <tt>static uint32_t now()</tt> that returns microseconds, see \ref AdaptiveChunks
+ * \tparam Capacity number of spans in the ring
+**/
+template <typename Clock, size_t Capacity = 512>
+class Recorder
+{
+  static_assert(Capacity > 0, "trace::Recorder: the capacity must be at least 1");
+
+  public:
+    /** \brief a recorded span **/
+    struct Span
+    {
+      uint32_t start; /**< start time in microseconds */
+      uint32_t duration; /**< duration in microseconds */
+      event kind;
+      uint32_t frame; /**< frame number */
+      uint16_t page; /**< page index */
+      uint16_t chunk; /**< chunk index in the page */
+    };
+
+    Recorder()
+      : head_(0),
+      writing_(0)
+    {
+    }
+
+    void begin(event e)
+    {
+      spans_.begin(e);
+    }
+
+    void end(event e, uint32_t frame, size_t page, size_t chunk)
+    {
+      uint32_t start;
+      uint32_t duration;
+      if (!spans_.end(e, start, duration))
+      {
+        return;
+      }
+      uint32_t i = head_.load(std::memory_order_relaxed);
+      // like the sequence counter of a seqlock: readers drop the slot that is being overwritten
+      writing_.store(i + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      std::atomic<uint32_t>* slot = ring_[i % Capacity];
+      slot[0].store(start, std::memory_order_relaxed);
+      slot[1].store(duration, std::memory_order_relaxed);
+      slot[2].store(((uint32_t)e << 28) | (frame & 0x0FFFFFFF), std::memory_order_relaxed);
+      slot[3].store(((uint32_t)(page & 0xFFFF) << 16) | (chunk & 0xFFFF), std::memory_order_relaxed);
+      head_.store(i + 1, std::memory_order_release);
+    }
+
+    void sent(size_t, size_t)
+    {
+    }
+
+    /** \brief number of spans recorded so far, including those that were overwritten **/
+    uint32_t recorded() const
+    {
+      return head_.load(std::memory_order_acquire);
+    }
+
+    /** \brief copy the recorded spans, oldest first
+     * \param out where to write the spans, room for Capacity spans
+     * \return number of spans written
+    **/
+    size_t snapshot(Span* out) const
+    {
+      uint32_t head = head_.load(std::memory_order_acquire);
+      size_t n = 0;
+      for (uint32_t i = (head > Capacity) ? head - Capacity : 0; i != head; i++)
+      {
+        if (read(i, out[n]))
+        {
+          n++;
+        }
+      }
+      return n;
+    }
+
+    /** \brief write the recorded spans as a Chrome trace event file (JSON). The spans are streamed from the
+     * ring without a copy, so any thread may export at any time.
+     * \param out a stream with operator<< for strings and integers, e.g. a std::ostream
+    **/
+    template <typename Stream>
+    void writeChromeTrace(Stream& out) const
+    {
+      uint32_t head = head_.load(std::memory_order_acquire);
+      out << "{\"traceEvents\":[";
+      for (size_t e = 0; e < events; e++)
+      {
+        out << (e ? "," : "") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << e
+            << ",\"args\":{\"name\":\"" << name((event)e) << "\"}}";
+      }
+      for (uint32_t i = (head > Capacity) ? head - Capacity : 0; i != head; i++)
+      {
+        Span s;
+        if (!read(i, s))
+        {
+          continue;
+        }
+        out << ",\n{\"name\":\"" << name(s.kind) << "\",\"cat\":\"sfc\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (unsigned)s.kind
+            << ",\"ts\":" << s.start << ",\"dur\":" << s.duration
+            << ",\"args\":{\"frame\":" << s.frame << ",\"page\":" << s.page << ",\"chunk\":" << s.chunk << "}}";
+      }
+      out << "\n]}\n";
+    }
+
+  private:
+    /** \brief read the i-th span written
+     * \return false if the writer started to overwrite it in the meantime, so it is not reliable
+    **/
+    bool read(uint32_t i, Span& span) const
+    {
+      const std::atomic<uint32_t>* slot = ring_[i % Capacity];
+      uint32_t id = slot[2].load(std::memory_order_relaxed);
+      uint32_t position = slot[3].load(std::memory_order_relaxed);
+      span.start = slot[0].load(std::memory_order_relaxed);
+      span.duration = slot[1].load(std::memory_order_relaxed);
+      span.kind = (event)(id >> 28);
+      span.frame = id & 0x0FFFFFFF;
+      span.page = position >> 16;
+      span.chunk = position & 0xFFFF;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return (uint32_t)(writing_.load(std::memory_order_relaxed) - i) <= Capacity;
+    }
+
+    std::atomic<uint32_t> ring_[Capacity][4]; /**< start, duration, kind and frame, page and chunk */
+    std::atomic<uint32_t> head_; /**< number of spans written */
+    std::atomic<uint32_t> writing_; /**< number of spans written, including the one being written */
+    Spans<Clock> spans_;
+};
+
+} // namespace trace
+
+#endif // SFC_OUTPUT_TRACE_H
@@ -0,0 +1,246 @@
+#ifndef SFC_OUTPUT_WIREFORMAT_H
+#define SFC_OUTPUT_WIREFORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../color/channel.h"
+#include "../color/colorRepresentation.h"
+
+/** \file wireFormat.h Wire formats: the bytes a display expects on its bus
+
+ * By default, chunks contain the display colors' storage as it is in memory (\ref wire::native). Many
+ * controllers expect something else, e.g. RGB565 in big endian, BGR channel order, RGB666 in three
+ * bytes or a 9-bit parallel bus. A display selects its format as \c wire_format_t in \ref display_traits,
+ * and the page buffer's chunk conversion then writes the final bytes in the same pass that converts
+ * (and dithers) the colors, so drivers don't need another pass over the chunk.
+ *
+ * A wire format provides
+ * \code
+ * static constexpr bool identity;        // true if the format is the colors' storage
+ * static constexpr size_t bytesPerPixel; // bytes per pixel on the wire (not needed for identity formats)
+ * template <typename Color>
+ * static void encode(const Color& c, uint8_t* out); // write one pixel's bytes
+ * \endcode
+ * The formats below encode RGB colors; channels are taken left aligned, so any RGB color type works.
+**/
+
+/** \brief Wire formats and the iterator that writes them **/
+namespace wire
+{
+
+/** \brief order of the bytes of a multi-byte word on the wire **/
+enum byte_order
+{
+  little_endian,
+  big_endian
+};
+
+
+/** \brief order of the channels on the wire, starting with the most significant **/
+enum channel_order
+{
+  rgb,
+  bgr
+};
+
+
+/** \brief the colors' storage, as it is in memory **/
+struct native
+{
+  static constexpr bool identity = true;
+};
+
+
+/** \brief channel values in wire order, left aligned in 8 bits **/
+template <channel_order Order, typename Color>
+void channels(const Color& c, uint8_t (&v)[3])
+{
+  v[0] = (Order == rgb) ? c.r().read(color::channel::left_aligned) : c.b().read(color::channel::left_aligned);
+  v[1] = c.g().read(color::channel::left_aligned);
+  v[2] = (Order == rgb) ? c.b().read(color::channel::left_aligned) : c.r().read(color::channel::left_aligned);
+}
+
+
+/** \brief channels packed into one word, e.g. RGB565 or RGB444 pairs
+ * \tparam First bits of the first (most significant) channel
+ * \tparam Second bits of the green channel
+ * \tparam Third bits of the last channel
+ * \tparam Order channel order
+ * \tparam Endian byte order of the word
+**/
+template <uint8_t First, uint8_t Second, uint8_t Third, channel_order Order = rgb, byte_order Endian = big_endian>
+struct packed
+{
+  static_assert(((First + Second + Third) % 8 == 0) && (First + Second + Third <= 32),
+                "wire::packed: the channels must fill whole bytes, at most 4");
+
+  static constexpr bool identity = false;
+  static constexpr size_t bytesPerPixel = (First + Second + Third)/8;
+
+  template <typename Color>
+  static void encode(const Color& c, uint8_t* out)
+  {
+    uint8_t v[3];
+    channels<Order>(c, v);
+    uint32_t word = ((uint32_t)(v[0] >> (8 - First)) << (Second + Third))
+                  | ((uint32_t)(v[1] >> (8 - Second)) << Third)
+                  | (v[2] >> (8 - Third));
+    for (size_t i = 0; i < bytesPerPixel; i++)
+    {
+      size_t shift = (Endian == big_endian) ? 8*(bytesPerPixel - 1 - i) : 8*i;
+      out[i] = (word >> shift) & 0xFF;
+    }
+  }
+};
+
+
+/** \brief one byte per channel, left aligned with zero padding, e.g. RGB666 in three bytes
+ * \tparam Bits bits per channel
+ * \tparam Order channel order
+**/
+template <uint8_t Bits, channel_order Order = rgb>
+struct bytes
+{
+  static_assert((Bits > 0) && (Bits <= 8), "wire::bytes: at most 8 bits per channel");
+
+  static constexpr bool identity = false;
+  static constexpr size_t bytesPerPixel = 3;
+
+  template <typename Color>
+  static void encode(const Color& c, uint8_t* out)
+  {
+    static constexpr uint8_t mask = (uint8_t)(0xFF << (8 - Bits));
+    uint8_t v[3];
+    channels<Order>(c, v);
+    out[0] = v[0] & mask;
+    out[1] = v[1] & mask;
+    out[2] = v[2] & mask;
+  }
+};
+
+
+/** \brief channels as one bit stream, split into transfers of a parallel bus. Each transfer is stored
+ * in a 16-bit word, as a bus FIFO or DMA expects it. Example: RGB666 on a 9-bit bus is two transfers,
+ * <tt>RRRRRRGGG</tt> and <tt>GGGBBBBBB</tt>.
+ * \tparam Bits bits per channel
+ * \tparam BusWidth bus width in bits, at most 16
+ * \tparam Order channel order
+ * \tparam Endian byte order of the 16-bit words
+**/
+template <uint8_t Bits, uint8_t BusWidth, channel_order Order = rgb, byte_order Endian = little_endian>
+struct bus
+{
+  static_assert((BusWidth > 0) && (BusWidth <= 16) && ((3*Bits) % BusWidth == 0),
+                "wire::bus: the pixel must be a whole number of transfers of at most 16 bits");
+
+  static constexpr bool identity = false;
+  static constexpr size_t transfers = 3*Bits/BusWidth;
+  static constexpr size_t bytesPerPixel = 2*transfers;
+
+  template <typename Color>
+  static void encode(const Color& c, uint8_t* out)
+  {
+    uint8_t v[3];
+    channels<Order>(c, v);
+    uint32_t stream = ((uint32_t)(v[0] >> (8 - Bits)) << (2*Bits))
+                    | ((uint32_t)(v[1] >> (8 - Bits)) << Bits)
+                    | (v[2] >> (8 - Bits));
+    for (size_t i = 0; i < transfers; i++)
+    {
+      uint16_t word = (stream >> (BusWidth*(transfers - 1 - i))) & ((1u << BusWidth) - 1);
+      out[2*i] = (Endian == big_endian) ? (word >> 8) : (word & 0xFF);
+      out[2*i + 1] = (Endian == big_endian) ? (word & 0xFF) : (word >> 8);
+    }
+  }
+};
+
+
+/** \brief number of bits a pixel of the given color occupies on the wire **/
+template <typename Format, typename Color, bool Identity = Format::identity>
+struct pixel_bits
+{
+  enum : size_t {value = color::colorRepresentation_traits<Color>::storage_bit_size};
+};
+
+
+template <typename Format, typename Color>
+struct pixel_bits<Format, Color, false>
+{
+  enum : size_t {value = 8*Format::bytesPerPixel};
+};
+
+
+typedef packed<5, 6, 5, rgb, big_endian> rgb565_be;
+typedef packed<5, 6, 5, bgr, big_endian> bgr565_be;
+typedef bytes<6, rgb> rgb666;
+typedef bytes<6, bgr> bgr666;
+typedef bus<6, 9, rgb> rgb666_bus9;
+
+
+/** \brief Output iterator that writes colors in a wire format
+ *
+ * Dereferencing returns a proxy color; when the proxy goes out of scope, the color it holds is encoded
+ * into the output, just like the proxies of \ref color::PackedColorArray. This way the conversion and
+ * dither stages, which assign or convert into <tt>*dst</tt>, produce wire bytes directly.
+ * \tparam Format the wire format
+ * \tparam Color the display color type
+**/
+template <typename Format, typename Color>
+class writer
+{
+  public:
+    class proxy : public Color
+    {
+      public:
+        proxy(uint8_t* out)
+          : out_(out)
+        {
+        }
+
+        template <typename C>
+        proxy& operator=(const C& c)
+        {
+          Color::operator=(c);
+          return *this;
+        }
+
+        ~proxy()
+        {
+          Format::encode(static_cast<const Color&>(*this), out_);
+        }
+
+      private:
+        uint8_t* out_;
+    };
+
+    writer(uint8_t* out)
+      : out_(out)
+    {
+    }
+
+    proxy operator*() const
+    {
+      return proxy(out_);
+    }
+
+    writer& operator++()
+    {
+      out_ += Format::bytesPerPixel;
+      return *this;
+    }
+
+    writer operator++(int)
+    {
+      writer previous(*this);
+      operator++();
+      return previous;
+    }
+
+  private:
+    uint8_t* out_;
+};
+
+} // namespace wire
+
+#endif // SFC_OUTPUT_WIREFORMAT_H
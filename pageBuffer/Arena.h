@@ -0,0 +1,206 @@
+#ifndef SFC_ARENA_H
+#define SFC_ARENA_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+/** \brief default alignment of buffer storage, in bytes. 64 bytes cover a cache line on most targets
+ * and the widest SIMD registers in common use, and satisfy the alignment requirements of DMA engines.
+**/
+static constexpr size_t buffer_alignment = 64;
+
+
+/** \brief round a size up to a multiple of an alignment (which must be a power of two) **/
+inline size_t alignUp(size_t size, size_t alignment)
+{
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+
+/** \brief Bump allocator over caller-supplied memory
+ *
+ * Runtime-dimensioned buffers (see \ref DynamicPageBuffer) take their storage from an allocator, which
+ * is any class with
+ * \code
+ * void* allocate(size_t bytes, size_t alignment); // returns 0 if the request can't be satisfied
+ * \endcode
+ * An Arena hands out consecutive, aligned blocks of one memory region, e.g. a static array placed in a
+ * DMA-capable section, or a huge page obtained from the OS. Memory is never freed individually; reset()
+ * makes the whole region available again.
+**/
+class Arena
+{
+  public:
+    /** \brief create an arena
+     * \param memory start of the region, which must outlive everything allocated from it
+     * \param size size of the region in bytes
+    **/
+    Arena(void* memory, size_t size)
+      : begin_(static_cast<uint8_t*>(memory)),
+      size_(size),
+      used_(0)
+    {
+    }
+
+    /** \brief allocate an aligned block
+     * \param bytes size of the block
+     * \param alignment alignment of the block, a power of two
+     * \return pointer to the block, or 0 if the arena is exhausted
+    **/
+    void* allocate(size_t bytes, size_t alignment = buffer_alignment)
+    {
+      size_t offset = alignUp((size_t)begin_ + used_, alignment) - (size_t)begin_;
+      if ((offset > size_) || (bytes > size_ - offset))
+      {
+        return 0;
+      }
+      used_ = offset + bytes;
+      return begin_ + offset;
+    }
+
+    /** \brief make the whole region available again. Everything allocated so far becomes invalid. **/
+    void reset()
+    {
+      used_ = 0;
+    }
+
+    size_t used() const
+    {
+      return used_;
+    }
+
+    size_t remaining() const
+    {
+      return size_ - used_;
+    }
+
+  private:
+    uint8_t* begin_;
+    size_t size_;
+    size_t used_;
+};
+
+
+/** \brief size of a \ref StorageArray whose size is chosen at runtime **/
+static constexpr size_t runtime_size = 0;
+
+
+/** \brief An array with a size fixed at compile time, or chosen at runtime with its storage taken from an
+ * allocator (see \ref Arena).
+ *
+ * Bookkeeping that depends on the number of pages or chunks, e.g. in \ref OutputManager or a chunk filter,
+ * uses a StorageArray, so it is a plain std::array for a \ref PageBuffer, and comes from the same allocator
+ * as the pixels for a \ref DynamicPageBuffer.
+ * \tparam T the element type, which must be trivially destructible
+ * \tparam Size the number of elements, or runtime_size
+**/
+template <typename T, size_t Size>
+class StorageArray : public std::array<T, Size>
+{
+};
+
+
+/** \brief StorageArray with a runtime size. It is empty until allocate() is called, and refers to the
+ * allocator's memory, so copies share the elements.
+**/
+template <typename T>
+class StorageArray<T, runtime_size>
+{
+  public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    StorageArray()
+      : data_(0), size_(0)
+    {
+    }
+
+    /** \brief number of bytes an allocator must provide for n elements, including alignment padding **/
+    static size_t storageSize(size_t n, size_t alignment = buffer_alignment)
+    {
+      return sizeof(T)*n + std::max(alignment, (size_t)alignof(T));
+    }
+
+    /** \brief take the storage for n value-initialized elements from an allocator
+     * \param allocator the allocator, see \ref Arena
+     * \param n number of elements
+     * \param alignment alignment of the storage
+     * \return false if the allocator couldn't provide the storage
+    **/
+    template <typename Allocator>
+    bool allocate(Allocator& allocator, size_t n, size_t alignment = buffer_alignment)
+    {
+      void* storage = allocator.allocate(sizeof(T)*n, std::max(alignment, (size_t)alignof(T)));
+      if (!storage)
+      {
+        return false;
+      }
+      data_ = static_cast<T*>(storage);
+      size_ = n;
+      for (size_t i = 0; i < n; i++)
+      {
+        ::new (static_cast<void*>(data_ + i)) T();
+      }
+      return true;
+    }
+
+    size_t size() const
+    {
+      return size_;
+    }
+
+    T* data()
+    {
+      return data_;
+    }
+
+    const T* data() const
+    {
+      return data_;
+    }
+
+    T& operator[](size_t i)
+    {
+      return data_[i];
+    }
+
+    const T& operator[](size_t i) const
+    {
+      return data_[i];
+    }
+
+    iterator begin()
+    {
+      return data_;
+    }
+
+    iterator end()
+    {
+      return data_ + size_;
+    }
+
+    const_iterator begin() const
+    {
+      return data_;
+    }
+
+    const_iterator end() const
+    {
+      return data_ + size_;
+    }
+
+    void fill(const T& value)
+    {
+      std::fill_n(data_, size_, value);
+    }
+
+  private:
+    T* data_;
+    size_t size_;
+};
+
+#endif // SFC_ARENA_H
@@ -0,0 +1,204 @@
+#ifndef SFC_BLIT_H
+#define SFC_BLIT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/** \file Blit.h Raster operations on packed pixels (BitBlt)
+
+ * Copying a bitmap through the proxies of a \ref color::PackedColorArray costs a read-modify-write of a
+ * storage word per pixel. The blit engine instead combines whole storage words: the source bits are
+ * shifted to the destination's bit offset, and only the first and last word of a run are masked.
+ *
+ * A source \ref raster::Bitmap has the same pixel format as the page buffer's frontend colors (their raw
+ * storage values, packed least significant bit first) and the same pixel mapping, with its own line
+ * width. For \ref LinearXYPixelMapping that is row-major rows, for \ref Staggered8BitPixelMapping it is
+ * the vertical bytes of SSD1306-style controllers and fonts.
+**/
+
+/** \brief Bit-blit engine, see \ref Blit.h **/
+namespace raster
+{
+
+/** \brief Raster operations, applied to whole storage words. Each provides
+ * <tt>template <typename W> static W apply(W dst, W src)</tt>.
+**/
+namespace rop
+{
+  /** \brief dst = src **/
+  struct Copy
+  {
+    template <typename W>
+    static W apply(W, W src) {return src;}
+  };
+
+
+  /** \brief dst = dst & src **/
+  struct And
+  {
+    template <typename W>
+    static W apply(W dst, W src) {return dst & src;}
+  };
+
+
+  /** \brief dst = dst | src **/
+  struct Or
+  {
+    template <typename W>
+    static W apply(W dst, W src) {return dst | src;}
+  };
+
+
+  /** \brief dst = dst ^ src **/
+  struct Xor
+  {
+    template <typename W>
+    static W apply(W dst, W src) {return dst ^ src;}
+  };
+
+
+  /** \brief dst = ~src **/
+  struct Not
+  {
+    template <typename W>
+    static W apply(W, W src) {return ~src;}
+  };
+
+
+  /** \brief dst = dst & ~src, i.e. clear where the source is set **/
+  struct AndNot
+  {
+    template <typename W>
+    static W apply(W dst, W src) {return dst & ~src;}
+  };
+}
+
+
+/** \brief A packed source image for blits
+ *
+ * The optional mask has the same layout and bits per pixel as the data; only destination bits whose mask
+ * bit is set are changed (set all bits of a pixel to select it).
+**/
+struct Bitmap
+{
+  /** \brief describe a bitmap
+   * \param data_ the pixels
+   * \param width_ width in pixels
+   * \param height_ height in pixels
+   * \param stride_ line width of the storage in pixels, at least width_ (e.g. to pad rows to bytes); 0 for width_
+   * \param mask_ optional mask, or 0
+  **/
+  Bitmap(const uint8_t* data_, size_t width_, size_t height_, size_t stride_ = 0, const uint8_t* mask_ = 0)
+    : data(data_), mask(mask_), width(width_), height(height_), stride(stride_ ? stride_ : width_)
+  {
+  }
+
+  const uint8_t* data;
+  const uint8_t* mask;
+  size_t width;
+  size_t height;
+  size_t stride;
+};
+
+
+/** \brief read n (at most the width of W) bits from a byte array, starting at a bit offset. Only the bytes
+ * that contain these bits are read.
+**/
+template <typename W>
+inline W loadBits(const uint8_t* src, size_t bit, size_t n)
+{
+  const uint8_t* p = src + bit/8;
+  const size_t shift = bit % 8;
+  const size_t bytes = (shift + n + 7)/8;
+  W w = 0;
+  for (size_t i = 0; (i < bytes) && (i < sizeof(W)); i++)
+  {
+    w |= (W)p[i] << (8*i);
+  }
+  w >>= shift;
+  if (bytes > sizeof(W))
+  {
+    w |= (W)p[sizeof(W)] << (8*sizeof(W) - shift);
+  }
+  return w;
+}
+
+
+/** \brief combine a run of n bits of the source with the destination
+ * \tparam Op the raster operation, see \ref rop
+ * \param dst destination storage words
+ * \param dstBit first destination bit
+ * \param src source bytes
+ * \param mask optional mask bytes, or 0
+ * \param srcBit first source (and mask) bit
+ * \param n number of bits
+**/
+template <typename Op, typename W>
+void blitBits(W* dst, size_t dstBit, const uint8_t* src, const uint8_t* mask, size_t srcBit, size_t n)
+{
+  static constexpr size_t wordBits = 8*sizeof(W);
+  W* d = dst + dstBit/wordBits;
+  size_t offset = dstBit % wordBits;
+  while (n)
+  {
+    size_t take = std::min(n, wordBits - offset);
+    W m = (W)((take == wordBits) ? ~(W)0 : (((W)1 << take) - 1)) << offset;
+    if (mask)
+    {
+      m &= loadBits<W>(mask, srcBit, take) << offset;
+    }
+    W s = loadBits<W>(src, srcBit, take) << offset;
+    *d = (*d & ~m) | (Op::apply(*d, s) & m);
+    d++;
+    srcBit += take;
+    n -= take;
+    offset = 0;
+  }
+}
+
+
+/** \brief blit a rectangle of a bitmap into packed storage. The rectangle must lie within both.
+ * \tparam Mapping the pixel mapping of destination and source, see \ref PixelMapping.h
+ * \tparam Bits bits per pixel
+ * \tparam Op the raster operation, see \ref rop
+ * \param dst destination storage words
+ * \param dstWidth line width of the destination in pixels
+ * \param dx destination column
+ * \param dy destination row
+ * \param src the source bitmap
+ * \param sx source column
+ * \param sy source row
+ * \param w width of the rectangle
+ * \param h height of the rectangle
+**/
+template <typename Mapping, size_t Bits, typename Op, typename W>
+void blit(W* dst, size_t dstWidth, size_t dx, size_t dy, const Bitmap& src, size_t sx, size_t sy, size_t w, size_t h)
+{
+  if (Mapping::xStride == 1)
+  {
+    // rows are contiguous: one run per row
+    for (size_t r = 0; r < h; r++)
+    {
+      blitBits<Op>(dst, Bits*Mapping::map(dx, dy + r, dstWidth), src.data, src.mask,
+                   Bits*Mapping::map(sx, sy + r, src.stride), Bits*w);
+    }
+    return;
+  }
+  // columns are contiguous within a bank: runs end where the destination's or the source's bank ends
+  static constexpr size_t bank = Mapping::lineLength;
+  for (size_t c = 0; c < w; c++)
+  {
+    for (size_t r = 0; r < h; )
+    {
+      size_t take = std::min(h - r, std::min(bank - (dy + r) % bank, bank - (sy + r) % bank));
+      blitBits<Op>(dst, Bits*Mapping::map(dx + c, dy + r, dstWidth), src.data, src.mask,
+                   Bits*Mapping::map(sx + c, sy + r, src.stride), Bits*take);
+      r += take;
+    }
+  }
+}
+
+} // namespace raster
+
+#endif // SFC_BLIT_H
@@ -2,22 +2,80 @@
 #define SFC_COLORBUFFER_H
 
 #include <algorithm>
+#include <array>
+#include <iostream>
+#include <type_traits>
 
+#include "../color/calibration.h"
 #include "../color/colorArray.h"
+#include "../color/planarColorArray.h"
+#include "../output/display.h"
 
-template <typename Display, typename Frontend, size_t Size, size_t ChunkSize, bool EqualColors>
+/** \brief Staging storage for chunks that are sent in the display's wire format
+ * \tparam Color the display color type
+ * \tparam Size the number of pixels
+ * \tparam Format the wire format, see \ref wireFormat.h
+**/
+template <typename Color, size_t Size, typename Format, bool Identity = Format::identity>
+class ChunkStaging;
+
+
+/** \brief ChunkStaging for the native wire format: the colors themselves **/
+template <typename Color, size_t Size, typename Format>
+class ChunkStaging<Color, Size, Format, true> : public color::ColorArray<Color, Size>
+{
+};
+
+
+/** \brief ChunkStaging for encoded wire formats: bytes, written through a \ref wire::writer **/
+template <typename Color, size_t Size, typename Format>
+class ChunkStaging<Color, Size, Format, false>
+{
+  public:
+    typedef wire::writer<Format, Color> iterator;
+
+    iterator begin()
+    {
+      return iterator(bytes_.data());
+    }
+
+    uint8_t* data()
+    {
+      return bytes_.data();
+    }
+
+    const uint8_t* data() const
+    {
+      return bytes_.data();
+    }
+
+  private:
+    std::array<uint8_t, Size*Format::bytesPerPixel> bytes_;
+};
+
+
+template <typename Display, typename Frontend, size_t Size, size_t ChunkSize, typename Conversion, typename Dither, bool EqualColors>
 class ColorBufferT;
 
 
-/** \brief ColorBufferT specialized for equal color types in backend and frontend
+/** \brief ColorBufferT specialized for equal color types in backend and frontend, without a calibrated conversion
  * \tparam Display the display type
  * \tparam Frontend the frontend type
  * \tparam Size the number of pixels in the buffer
+ * \tparam Conversion the conversion class, always \ref color::DirectConversion, which leaves equal colors unchanged
+ * \tparam Dither the output stage, unused because there is nothing to convert
 **/
-template <typename Display, typename Frontend, size_t Size, size_t ChunkSize>
-class ColorBufferT<Display, Frontend, Size, ChunkSize, true>
+template <typename Display, typename Frontend, size_t Size, size_t ChunkSize, typename Conversion, typename Dither>
+class ColorBufferT<Display, Frontend, Size, ChunkSize, Conversion, Dither, true>
 {
   public:
+    typedef typename display_traits<Display>::wire_format_t wire_format_t;
+
+    /** \brief makeChunk() returns pointers into the buffer, which stay valid until the page changes,
+     * unless the colors must be encoded for the wire
+    **/
+    static constexpr bool inPlace = wire_format_t::identity;
+
     typedef color::ColorArray<typename Frontend::color_t, Size> array_type;
     typedef array_type frontend_array_type;
     typedef array_type backend_array_type;
@@ -42,30 +100,60 @@ class ColorBufferT<Display, Frontend, Size, ChunkSize, true>
       return array_;
     }
 
+    void beginFrame()
+    {
+    }
+
+    void beginPage(const size_t&)
+    {
+    }
+
     const uint8_t* makeChunk(const size_t& pixelOffset, const size_t& size)
     {
       std::cout << "ColorBuffer<sameTypes>::makeChunk(offset " << (size_t)pixelOffset << " , " << size << " bytes )\n";
       std::cout << "  storage size: " << (size_t)color::colorRepresentation_traits<typename Display::color_t>::storage_bit_size << "\n";
+      return makeChunk(pixelOffset, size, std::integral_constant<bool, inPlace>());
+    }
+  private:
+    const uint8_t* makeChunk(const size_t& pixelOffset, const size_t&, std::true_type)
+    {
       size_t byteOffset = (color::colorRepresentation_traits<typename Display::color_t>::storage_bit_size*pixelOffset)/8;
       return (const uint8_t*)(array_.data())+byteOffset;
     }
-  private:
+
+    const uint8_t* makeChunk(const size_t& pixelOffset, const size_t& size, std::false_type)
+    {
+      const array_type& array = array_;
+      std::copy_n(array.begin() + pixelOffset, size, staging_.begin());
+      return staging_.data();
+    }
+
     array_type array_;
+    ChunkStaging<typename Display::color_t, inPlace ? 0 : ChunkSize, wire_format_t> staging_;
 };
 
 
-/** \brief ColorBufferT specialized for different color types in display and frontend
+/** \brief ColorBufferT specialized for different color types in display and frontend, or for a conversion
+ * that changes colors even when the types are equal, e.g. \ref color::CalibratedConversion
  * \tparam Display the display type
  * \tparam Frontend the frontend type
  * \tparam Size the number of pixels in the buffer
+ * \tparam Conversion the conversion class that maps frontend to display colors, see \ref color::DirectConversion
+ * \tparam Dither the output stage that quantizes converted colors for the display, see \ref NoDither
 **/
-template <typename Display, typename Frontend, size_t Size, size_t ChunkSize>
-class ColorBufferT<Display, Frontend, Size, ChunkSize, false>
+template <typename Display, typename Frontend, size_t Size, size_t ChunkSize, typename Conversion, typename Dither>
+class ColorBufferT<Display, Frontend, Size, ChunkSize, Conversion, Dither, false>
 {
   public:
+    /** \brief makeChunk() converts into a staging array that is overwritten by the next call **/
+    static constexpr bool inPlace = false;
+
     typedef color::ColorArray<typename Frontend::color_t, Size> frontend_array_type;
 
-    typedef color::ColorArray<typename Display::color_t, ChunkSize> backend_array_type;
+    typedef typename display_traits<Display>::wire_format_t wire_format_t;
+
+    /** \brief converted colors, or their wire bytes if the display needs an encoded wire format **/
+    typedef ChunkStaging<typename Display::color_t, ChunkSize, wire_format_t> backend_array_type;
 
     frontend_array_type& frontend()
     {
@@ -87,25 +175,146 @@ class ColorBufferT<Display, Frontend, Size, ChunkSize, false>
       return outputArray_;
     }
 
+    /** \brief reset the output stage's state for a new frame **/
+    void beginFrame()
+    {
+      dither_.beginFrame();
+    }
+
+    /** \brief tell the output stage where the buffer's content is located in the frame
+     * \param pixelOffset offset of the page's first pixel in the frame, in buffer order
+    **/
+    void beginPage(const size_t& pixelOffset)
+    {
+      pageOffset_ = pixelOffset;
+    }
+
     const uint8_t* makeChunk(const size_t& pixelOffset, const size_t& size)
     {
       std::cout << "ColorBuffer<diffTypes>::makeChunk(offset " << (size_t)pixelOffset << " , " << size << " bytes )\n";
-      std::copy_n(frontendArray_.begin() + pixelOffset, size, outputArray_.begin());
+      const frontend_array_type& frontendArray = frontendArray_;
+      dither_.template convert<Conversion>(frontendArray.begin() + pixelOffset, outputArray_.begin(), size, pageOffset_ + pixelOffset);
       return (const uint8_t*)(outputArray_.data());
     }
 
   private:
     frontend_array_type frontendArray_;
     backend_array_type outputArray_;
+    Dither dither_;
+    size_t pageOffset_;
+};
+
+
+/** \brief whether chunks can be taken from the frontend colors as they are: the color types are equal and
+ * the conversion doesn't change colors
+**/
+template<typename Display, typename Frontend, typename Conversion>
+struct unconverted_colors
+  : std::integral_constant<bool, std::is_same<typename Display::color_t, typename Frontend::color_t>::value
+                                 && std::is_same<Conversion, color::DirectConversion>::value>
+{
 };
 
 
-template<typename Display, typename Frontend, size_t Size, size_t ChunkSize>
-class ColorBuffer : public ColorBufferT<Display, Frontend, Size, ChunkSize,
-                                        std::is_same<typename Display::color_t,
-                                        typename Frontend::color_t>::value>
+/** \brief how a color buffer's frontend array stores colors, for block operations on rows: 0 in another
+ * layout (e.g. planes), 1 as contiguous elements, 2 as packed bits in storage words
+**/
+template <typename Array>
+struct frontend_storage : public std::integral_constant<int, 0>
 {
+};
 
+template <typename Color, size_t Size>
+struct frontend_storage<color::ColorArray<Color, Size> >
+  : public std::integral_constant<int, std::is_base_of<color::PackedColorArray<Color, Size>, color::ColorArray<Color, Size> >::value ? 2
+                                      : std::is_base_of<std::array<Color, Size>, color::ColorArray<Color, Size> >::value ? 1 : 0>
+{
+};
+
+
+/** \brief A buffer of frontend colors, and the stage that converts chunks of them for the display
+ * \tparam Layout memory layout of the frontend colors, \ref color::layout::interleaved or \ref color::layout::planar
+**/
+template<typename Display, typename Frontend, size_t Size, size_t ChunkSize, typename Conversion, typename Dither,
+         typename Layout = color::layout::interleaved>
+class ColorBuffer : public ColorBufferT<Display, Frontend, Size, ChunkSize, Conversion, Dither,
+                                        unconverted_colors<Display, Frontend, Conversion>::value>
+{
+
+};
+
+
+/** \brief ColorBuffer with planar frontend colors, see \ref color::PlanarColorArray
+ *
+ * Chunks are always converted into a staging array: equal color types are interleaved straight from the
+ * planes into the display's layout or wire format, different ones, or a calibrated conversion, go through
+ * the conversion and output stage.
+**/
+template<typename Display, typename Frontend, size_t Size, size_t ChunkSize, typename Conversion, typename Dither>
+class ColorBuffer<Display, Frontend, Size, ChunkSize, Conversion, Dither, color::layout::planar>
+{
+  public:
+    /** \brief makeChunk() converts into a staging array that is overwritten by the next call **/
+    static constexpr bool inPlace = false;
+
+    typedef color::PlanarColorArray<typename Frontend::color_t, Size> frontend_array_type;
+
+    typedef typename display_traits<Display>::wire_format_t wire_format_t;
+
+    typedef ChunkStaging<typename Display::color_t, ChunkSize, wire_format_t> backend_array_type;
+
+    frontend_array_type& frontend()
+    {
+      return frontendArray_;
+    }
+
+    const frontend_array_type& frontend() const
+    {
+      return frontendArray_;
+    }
+
+    backend_array_type& backend()
+    {
+      return outputArray_;
+    }
+
+    const backend_array_type& backend() const
+    {
+      return outputArray_;
+    }
+
+    void beginFrame()
+    {
+      dither_.beginFrame();
+    }
+
+    void beginPage(const size_t& pixelOffset)
+    {
+      pageOffset_ = pixelOffset;
+    }
+
+    const uint8_t* makeChunk(const size_t& pixelOffset, const size_t& size)
+    {
+      makeChunk(pixelOffset, size, unconverted_colors<Display, Frontend, Conversion>());
+      return (const uint8_t*)(outputArray_.data());
+    }
+
+  private:
+    void makeChunk(const size_t& pixelOffset, const size_t& size, std::true_type)
+    {
+      frontendArray_.interleave(pixelOffset, size, outputArray_.begin());
+    }
+
+    void makeChunk(const size_t& pixelOffset, const size_t& size, std::false_type)
+    {
+      const frontend_array_type& frontendArray = frontendArray_;
+      dither_.template convert<Conversion>(frontendArray.begin() + pixelOffset, outputArray_.begin(), size, pageOffset_ + pixelOffset);
+    }
+
+    frontend_array_type frontendArray_;
+    backend_array_type outputArray_;
+    Dither dither_;
+    size_t pageOffset_;
 };
 
 #endif // SFC_COLORBUFFER_H
@@ -0,0 +1,409 @@
+#ifndef SFC_DITHER_H
+#define SFC_DITHER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+#include "../color/calibration.h"
+#include "../color/lut.h"
+#include "../color/rgb24.h"
+#include "Arena.h"
+#include "PixelMapping.h"
+
+/** \file Dither.h Output conversion stages for ColorBuffers
+
+ * When the frontend and the display use different color types, a ColorBuffer converts every chunk
+ * before it is sent. A plain conversion truncates channels, which causes visible banding on displays
+ * with low bit depths. The stages in this file can be selected as \c dither_t in \ref pageBuffer_traits
+ * to distribute the quantization error instead.
+ *
+ * All stages work on the buffer's native order, as described by the display's \ref PixelMapping. A
+ * \e line is PixelMapping<Display>::lineLength consecutive buffer elements (a row for linear mappings,
+ * a vertical run of 8 pixels for staggered mappings). Source colors are first converted to 8 bits per
+ * channel (RGB24 or Grayscale<8>) with the buffer's conversion class (\ref color::DirectConversion or
+ * \ref color::CalibratedConversion) and then quantized to the display's channel widths using
+ * compile-time tables. A PageBuffer with one of these stages draws with the frontend's colors rather than
+ * its traits' color_t, so no precision is lost before the stage runs.
+ *
+ * A \ref DynamicPageBuffer only knows its line length at runtime. It uses the stage with RuntimeLength set
+ * (see dither::runtime), and calls
+ * \code
+ * static size_t storageSize(size_t lineLength, size_t alignment); // bytes the stage needs from the allocator
+ * template <typename Allocator>
+ * bool allocate(Allocator& allocator, size_t lineLength, size_t alignment); // false if out of memory
+ * \endcode
+ * before the first frame.
+**/
+
+namespace dither
+{
+
+/** \brief Generator for a 4x4 Bayer threshold matrix with values 0..15, row-major **/
+struct Bayer4x4Generator
+{
+  typedef uint8_t value_type;
+
+  static constexpr value_type value(size_t i)
+  {
+    return ((((i & 3) ^ (i >> 2)) & 1) << 3)
+         | (((i >> 2) & 1) << 2)
+         | (((((i & 3) ^ (i >> 2)) >> 1) & 1) << 1)
+         | ((i >> 3) & 1);
+  }
+};
+
+typedef color::lut::Table<Bayer4x4Generator, 16> bayer4x4;
+
+
+/** \brief Generator that scales an 8-bit value to (2^Width-1) levels with 4 fractional bits
+ * \tparam Width channel width of the target color
+**/
+template<unsigned int Width>
+struct OrderedScaleGenerator
+{
+  typedef uint16_t value_type;
+
+  static constexpr value_type value(size_t v)
+  {
+    return (v*((1u << Width) - 1)*16 + 127)/255;
+  }
+};
+
+
+/** \brief Generator that rounds an 8-bit value to the nearest of (2^Width-1) levels **/
+template<unsigned int Width>
+struct QuantizeGenerator
+{
+  typedef uint8_t value_type;
+
+  static constexpr value_type value(size_t v)
+  {
+    return (v*((1u << Width) - 1) + 127)/255;
+  }
+};
+
+
+/** \brief Generator that maps a level back to its 8-bit value, inverse of QuantizeGenerator **/
+template<unsigned int Width>
+struct ReconstructGenerator
+{
+  typedef uint8_t value_type;
+
+  static constexpr value_type value(size_t q)
+  {
+    return (q*255 + ((1u << Width) - 1)/2)/((1u << Width) - 1);
+  }
+};
+
+
+/** \brief Ordered quantization of a single 8-bit channel value
+ * \tparam Width channel width of the target color
+ * \param v 8-bit channel value
+ * \param t threshold from the Bayer matrix, 0..15
+ * \return quantized channel value, right aligned
+**/
+template<unsigned int Width>
+inline uint8_t orderedChannel(uint8_t v, uint8_t t)
+{
+  return (color::lut::Table<OrderedScaleGenerator<Width>, 256>::data[v] + t) >> 4;
+}
+
+template<typename Conversion, typename To, typename From>
+void orderedPixel(color::RgbBase<To>& to, const From& from, uint8_t t)
+{
+  typedef color::RgbBase_traits<To> traits;
+  color::RGB24 c;
+  Conversion::convert(c, from);
+  to.r().write(orderedChannel<traits::r_proxy::Width>(c.r(), t));
+  to.g().write(orderedChannel<traits::g_proxy::Width>(c.g(), t));
+  to.b().write(orderedChannel<traits::b_proxy::Width>(c.b(), t));
+}
+
+template<typename Conversion, uint8_t To, typename From>
+void orderedPixel(color::Grayscale<To>& to, const From& from, uint8_t t)
+{
+  color::Grayscale<8> c;
+  Conversion::convert(c, from);
+  to.k().write(orderedChannel<To>(c.k(), t));
+}
+
+
+/** \brief Error diffusion of a single 8-bit channel value.
+ *
+ * Errors are stored in 1/16 units, so the Floyd-Steinberg weights 7, 3, 5 and 1 are plain integer
+ * multiplications.
+ * \tparam Width channel width of the target color
+ * \param v 8-bit channel value
+ * \param cur error accumulator of the current line, at the current position
+ * \param next error accumulator of the next line, at the current position
+ * \param right error carried from the previous pixel on the same line
+ * \return quantized channel value, right aligned
+**/
+template<unsigned int Width>
+inline uint8_t diffuseChannel(uint8_t v, const int16_t* cur, int16_t* next, int16_t& right)
+{
+  int16_t sum = v + (*cur + right)/16;
+  uint8_t clamped = std::min<int16_t>(255, std::max<int16_t>(0, sum));
+  uint8_t q = color::lut::Table<QuantizeGenerator<Width>, 256>::data[clamped];
+  int16_t e = clamped - color::lut::Table<ReconstructGenerator<Width>, 256>::data[q];
+  right = 7*e;
+  next[-1] += 3*e;
+  next[0] += 5*e;
+  next[1] += e;
+  return q;
+}
+
+template<typename Conversion, typename To, typename From>
+void diffusePixel(color::RgbBase<To>& to, const From& from, int16_t* const* cur, int16_t* const* next, int16_t* right)
+{
+  typedef color::RgbBase_traits<To> traits;
+  color::RGB24 c;
+  Conversion::convert(c, from);
+  to.r().write(diffuseChannel<traits::r_proxy::Width>(c.r(), cur[0], next[0], right[0]));
+  to.g().write(diffuseChannel<traits::g_proxy::Width>(c.g(), cur[1], next[1], right[1]));
+  to.b().write(diffuseChannel<traits::b_proxy::Width>(c.b(), cur[2], next[2], right[2]));
+}
+
+template<typename Conversion, uint8_t To, typename From>
+void diffusePixel(color::Grayscale<To>& to, const From& from, int16_t* const* cur, int16_t* const* next, int16_t* right)
+{
+  color::Grayscale<8> c;
+  Conversion::convert(c, from);
+  to.k().write(diffuseChannel<To>(c.k(), cur[0], next[0], right[0]));
+}
+
+
+/** \brief number of channels an output stage has to process for a color **/
+template<typename Color>
+struct channels : public std::integral_constant<size_t,
+  std::is_base_of<color::RgbBase<Color>, Color>::value ? 3 : 1>
+{
+};
+
+} // namespace dither
+
+
+/** \brief Output stage that converts without dithering (channels are truncated)
+ * \tparam Display the display type
+**/
+template<typename Display>
+class NoDither
+{
+  public:
+    static size_t storageSize(size_t, size_t)
+    {
+      return 0;
+    }
+
+    template <typename Allocator>
+    bool allocate(Allocator&, size_t, size_t)
+    {
+      return true;
+    }
+
+    void beginFrame()
+    {
+    }
+
+    /** \brief convert a chunk
+     * \tparam Conversion the conversion class that maps frontend to display colors
+     * \param src iterator to the first frontend color
+     * \param dst iterator to the first backend color
+     * \param n number of pixels
+     * \param offset offset of the first pixel in the frame, in buffer order
+    **/
+    template<typename Conversion, typename Src, typename Dst>
+    void convert(Src src, Dst dst, size_t n, size_t)
+    {
+      Conversion::copy(src, dst, n);
+    }
+};
+
+
+/** \brief Output stage for ordered (Bayer 4x4) dithering
+ *
+ * The threshold only depends on a pixel's position, so chunks are independent of each other and the
+ * inner loop contains nothing but table lookups.
+ * \tparam Display the display type
+ * \tparam RuntimeLength whether the line length is set with allocate() instead of taken from the PixelMapping
+**/
+template<typename Display, bool RuntimeLength = false>
+class OrderedDither
+{
+  public:
+    static constexpr size_t lineLength = RuntimeLength ? 0 : PixelMapping<Display>::lineLength;
+
+    OrderedDither()
+      : lineLength_(lineLength)
+    {
+    }
+
+    static size_t storageSize(size_t, size_t)
+    {
+      return 0;
+    }
+
+    /** \brief set the line length; nothing is allocated **/
+    template <typename Allocator>
+    bool allocate(Allocator&, size_t lineLength, size_t)
+    {
+      lineLength_ = lineLength;
+      return lineLength != 0;
+    }
+
+    void beginFrame()
+    {
+    }
+
+    template<typename Conversion, typename Src, typename Dst>
+    void convert(Src src, Dst dst, size_t n, size_t offset)
+    {
+      const size_t length = RuntimeLength ? lineLength_ : (size_t)lineLength;
+      size_t line = offset / length;
+      size_t pos = offset % length;
+      while (n)
+      {
+        size_t run = std::min(n, length - pos);
+        const uint8_t* thresholds = dither::bayer4x4::data + 4*(line & 3);
+        for (size_t i = 0; i < run; ++i, ++src, ++dst)
+        {
+          auto&& to = *dst;
+          dither::orderedPixel<Conversion>(to, *src, thresholds[(pos + i) & 3]);
+        }
+        n -= run;
+        pos = 0;
+        line++;
+      }
+    }
+
+  private:
+    size_t lineLength_;
+};
+
+
+/** \brief Output stage for Floyd-Steinberg error diffusion
+ *
+ * Chunks must be converted in frame order. The error of the current and the next line are carried
+ * across chunk and page boundaries, and are reset when a new frame begins.
+ * \tparam Display the display type
+ * \tparam RuntimeLength whether the line length is set with allocate() instead of taken from the PixelMapping
+**/
+template<typename Display, bool RuntimeLength = false>
+class FloydSteinbergDither
+{
+  public:
+    static constexpr size_t lineLength = RuntimeLength ? 0 : PixelMapping<Display>::lineLength;
+    static constexpr size_t channels = dither::channels<typename Display::color_t>::value;
+
+    FloydSteinbergDither()
+      : lineLength_(lineLength)
+    {
+      beginFrame();
+    }
+
+    /** \brief number of bytes an allocator must provide for the error lines, including alignment padding **/
+    static size_t storageSize(size_t lineLength, size_t alignment)
+    {
+      return StorageArray<int16_t, runtime_size>::storageSize(2*channels*(lineLength + 2), alignment);
+    }
+
+    /** \brief set the line length and take the error lines from an allocator
+     * \return false if the allocator couldn't provide the storage
+    **/
+    template <typename Allocator>
+    bool allocate(Allocator& allocator, size_t lineLength, size_t alignment)
+    {
+      lineLength_ = lineLength;
+      bool result = (lineLength != 0) && errors_.allocate(allocator, 2*channels*(lineLength + 2), alignment);
+      beginFrame();
+      return result;
+    }
+
+    void beginFrame()
+    {
+      std::fill(errors_.begin(), errors_.end(), 0);
+      std::fill_n(right_, channels, 0);
+      cur_ = 0;
+      pos_ = 0;
+    }
+
+    template<typename Conversion, typename Src, typename Dst>
+    void convert(Src src, Dst dst, size_t n, size_t)
+    {
+      const size_t length = RuntimeLength ? lineLength_ : (size_t)lineLength;
+      while (n)
+      {
+        size_t run = std::min(n, length - pos_);
+        int16_t* cur[channels];
+        int16_t* next[channels];
+        for (size_t c = 0; c < channels; c++)
+        {
+          cur[c] = errors(cur_, c) + pos_ + 1;
+          next[c] = errors(cur_ ^ 1, c) + pos_ + 1;
+        }
+        for (size_t i = 0; i < run; ++i, ++src, ++dst)
+        {
+          auto&& to = *dst;
+          dither::diffusePixel<Conversion>(to, *src, cur, next, right_);
+          for (size_t c = 0; c < channels; c++)
+          {
+            cur[c]++;
+            next[c]++;
+          }
+        }
+        n -= run;
+        pos_ += run;
+        if (pos_ == length)
+        {
+          std::fill_n(errors(cur_, 0), channels*(length + 2), 0);
+          std::fill_n(right_, channels, 0);
+          cur_ ^= 1;
+          pos_ = 0;
+        }
+      }
+    }
+
+  private:
+    /** \brief the error accumulators of a line (0 or 1) and channel **/
+    int16_t* errors(size_t line, size_t channel)
+    {
+      const size_t length = RuntimeLength ? lineLength_ : (size_t)lineLength;
+      return errors_.data() + (line*channels + channel)*(length + 2);
+    }
+
+    StorageArray<int16_t, RuntimeLength ? runtime_size : 2*channels*(lineLength + 2)> errors_;
+    int16_t right_[channels];
+    uint8_t cur_;
+    size_t pos_;
+    size_t lineLength_;
+};
+
+
+namespace dither
+{
+
+/** \brief the output stage a \ref DynamicPageBuffer uses for a stage selected in \ref pageBuffer_traits:
+ * the same stage with a line length that is set at runtime
+**/
+template <typename Dither>
+struct runtime
+{
+  typedef Dither type;
+};
+
+template <typename Display, bool RuntimeLength>
+struct runtime<OrderedDither<Display, RuntimeLength> >
+{
+  typedef OrderedDither<Display, true> type;
+};
+
+template <typename Display, bool RuntimeLength>
+struct runtime<FloydSteinbergDither<Display, RuntimeLength> >
+{
+  typedef FloydSteinbergDither<Display, true> type;
+};
+
+} // namespace dither
+
+#endif // SFC_DITHER_H
@@ -0,0 +1,345 @@
+#ifndef SFC_DYNAMICCOLORBUFFER_H
+#define SFC_DYNAMICCOLORBUFFER_H
+
+#include <algorithm>
+#include <type_traits>
+
+#include "../color/colorSpan.h"
+#include "../output/display.h"
+#include "Arena.h"
+#include "ColorBuffer.h"
+
+/** \brief Runtime-sized counterpart of \ref ChunkStaging, in storage taken from an allocator
+ * \tparam Color the display color type
+ * \tparam Format the wire format, see \ref wireFormat.h
+**/
+template <typename Color, typename Format, bool Identity = Format::identity>
+class DynamicChunkStaging;
+
+
+/** \brief DynamicChunkStaging for the native wire format: the colors themselves **/
+template <typename Color, typename Format>
+class DynamicChunkStaging<Color, Format, true> : public color::ColorSpan<Color>
+{
+  public:
+    DynamicChunkStaging()
+    {
+    }
+
+    DynamicChunkStaging(void* storage, size_t n)
+      : color::ColorSpan<Color>(storage, n)
+    {
+    }
+};
+
+
+/** \brief DynamicChunkStaging for encoded wire formats: bytes, written through a \ref wire::writer **/
+template <typename Color, typename Format>
+class DynamicChunkStaging<Color, Format, false>
+{
+  public:
+    typedef wire::writer<Format, Color> iterator;
+
+    static constexpr size_t alignment = 1;
+
+    /** \brief number of bytes needed to stage n pixels **/
+    static size_t bytes(size_t n)
+    {
+      return n*Format::bytesPerPixel;
+    }
+
+    DynamicChunkStaging()
+      : data_(0), size_(0)
+    {
+    }
+
+    DynamicChunkStaging(void* storage, size_t n)
+      : data_(static_cast<uint8_t*>(storage)), size_(n)
+    {
+    }
+
+    /** \brief number of pixels **/
+    size_t size() const
+    {
+      return size_;
+    }
+
+    iterator begin()
+    {
+      return iterator(data_);
+    }
+
+    uint8_t* data()
+    {
+      return data_;
+    }
+
+    const uint8_t* data() const
+    {
+      return data_;
+    }
+
+  private:
+    uint8_t* data_;
+    size_t size_;
+};
+
+
+template <typename Display, typename Frontend, typename Conversion, typename Dither, bool EqualColors>
+class DynamicColorBufferT;
+
+
+/** \brief DynamicColorBufferT specialized for equal color types in backend and frontend, without a calibrated conversion
+ * \tparam Display the display type
+ * \tparam Frontend the frontend type
+ * \tparam Conversion the conversion class, always \ref color::DirectConversion, which leaves equal colors unchanged
+ * \tparam Dither the output stage, unused because there is nothing to convert
+**/
+template <typename Display, typename Frontend, typename Conversion, typename Dither>
+class DynamicColorBufferT<Display, Frontend, Conversion, Dither, true>
+{
+  public:
+    typedef typename display_traits<Display>::wire_format_t wire_format_t;
+
+    /** \brief makeChunk() returns pointers into the buffer, which stay valid until the page changes,
+     * unless the colors must be encoded for the wire
+    **/
+    static constexpr bool inPlace = wire_format_t::identity;
+
+    typedef color::ColorSpan<typename Frontend::color_t> array_type;
+    typedef array_type frontend_array_type;
+    typedef array_type backend_array_type;
+    typedef DynamicChunkStaging<typename Display::color_t, wire_format_t> staging_type;
+
+    /** \brief number of bytes an allocator must provide, including alignment padding **/
+    static size_t storageSize(size_t size, size_t chunkSize, size_t, size_t alignment = buffer_alignment)
+    {
+      return array_type::bytes(size) + alignment + (inPlace ? 0 : staging_type::bytes(chunkSize) + alignment);
+    }
+
+    /** \brief allocate storage
+     * \param allocator the allocator, see \ref Arena
+     * \param size the number of pixels in the buffer
+     * \param chunkSize the maximum number of pixels per chunk, the size of the staging array for encoded wire formats
+     * \param lineLength the output stage's line length, unused
+     * \param alignment alignment of the storage
+    **/
+    template <typename Allocator>
+    DynamicColorBufferT(Allocator& allocator, size_t size, size_t chunkSize, size_t, size_t alignment = buffer_alignment)
+    {
+      void* storage = allocator.allocate(array_type::bytes(size), std::max(alignment, (size_t)array_type::alignment));
+      void* staging = inPlace ? storage
+        : allocator.allocate(staging_type::bytes(chunkSize), std::max(alignment, (size_t)staging_type::alignment));
+      if (storage && staging)
+      {
+        array_ = array_type(storage, size);
+        if (!inPlace)
+        {
+          staging_ = staging_type(staging, chunkSize);
+        }
+      }
+    }
+
+    /** \brief false if the allocator couldn't provide the storage **/
+    bool valid() const
+    {
+      return array_.data() != 0;
+    }
+
+    frontend_array_type& frontend()
+    {
+      return array_;
+    }
+
+    const frontend_array_type& frontend() const
+    {
+      return array_;
+    }
+
+    backend_array_type& backend()
+    {
+      return array_;
+    }
+
+    const backend_array_type& backend() const
+    {
+      return array_;
+    }
+
+    void beginFrame()
+    {
+    }
+
+    void beginPage(const size_t&)
+    {
+    }
+
+    /** \brief get a chunk
+     * \return the chunk, or 0 if it has to be staged and size exceeds the chunk size the buffer was created with
+    **/
+    const uint8_t* makeChunk(const size_t& pixelOffset, const size_t& size)
+    {
+      return makeChunk(pixelOffset, size, std::integral_constant<bool, inPlace>());
+    }
+
+  private:
+    const uint8_t* makeChunk(const size_t& pixelOffset, const size_t&, std::true_type)
+    {
+      size_t byteOffset = (color::colorRepresentation_traits<typename Display::color_t>::storage_bit_size*pixelOffset)/8;
+      return (const uint8_t*)(array_.data())+byteOffset;
+    }
+
+    const uint8_t* makeChunk(const size_t& pixelOffset, const size_t& size, std::false_type)
+    {
+      if (size > staging_.size())
+      {
+        return 0;
+      }
+      const array_type& array = array_;
+      std::copy_n(array.begin() + pixelOffset, size, staging_.begin());
+      return staging_.data();
+    }
+
+    array_type array_;
+    staging_type staging_;
+};
+
+
+/** \brief DynamicColorBufferT specialized for different color types in display and frontend, or for a
+ * conversion that changes colors even when the types are equal, e.g. \ref color::CalibratedConversion
+ * \tparam Display the display type
+ * \tparam Frontend the frontend type
+ * \tparam Conversion the conversion class that maps frontend to display colors, see \ref color::DirectConversion
+ * \tparam Dither the output stage that quantizes converted colors for the display, with its line length set
+ *         at runtime, see dither::runtime
+**/
+template <typename Display, typename Frontend, typename Conversion, typename Dither>
+class DynamicColorBufferT<Display, Frontend, Conversion, Dither, false>
+{
+  public:
+    /** \brief makeChunk() converts into a staging array that is overwritten by the next call **/
+    static constexpr bool inPlace = false;
+
+    typedef color::ColorSpan<typename Frontend::color_t> frontend_array_type;
+
+    typedef typename display_traits<Display>::wire_format_t wire_format_t;
+
+    /** \brief converted colors, or their wire bytes if the display needs an encoded wire format **/
+    typedef DynamicChunkStaging<typename Display::color_t, wire_format_t> backend_array_type;
+
+    /** \brief number of bytes an allocator must provide, including alignment padding **/
+    static size_t storageSize(size_t size, size_t chunkSize, size_t lineLength, size_t alignment = buffer_alignment)
+    {
+      return frontend_array_type::bytes(size) + backend_array_type::bytes(chunkSize) + 2*alignment
+        + Dither::storageSize(lineLength, alignment);
+    }
+
+    /** \brief allocate storage
+     * \param allocator the allocator, see \ref Arena
+     * \param size the number of pixels in the buffer
+     * \param chunkSize the maximum number of pixels per chunk, i.e. the size of the staging array
+     * \param lineLength the output stage's line length, see \ref PixelMapping
+     * \param alignment alignment of the storage
+    **/
+    template <typename Allocator>
+    DynamicColorBufferT(Allocator& allocator, size_t size, size_t chunkSize, size_t lineLength, size_t alignment = buffer_alignment)
+      : pageOffset_(0)
+    {
+      void* frontend = allocator.allocate(frontend_array_type::bytes(size), std::max(alignment, (size_t)frontend_array_type::alignment));
+      void* output = allocator.allocate(backend_array_type::bytes(chunkSize), std::max(alignment, (size_t)backend_array_type::alignment));
+      if (frontend && output && dither_.allocate(allocator, lineLength, alignment))
+      {
+        frontendArray_ = frontend_array_type(frontend, size);
+        outputArray_ = backend_array_type(output, chunkSize);
+      }
+    }
+
+    /** \brief false if the allocator couldn't provide the storage **/
+    bool valid() const
+    {
+      return frontendArray_.data() != 0;
+    }
+
+    frontend_array_type& frontend()
+    {
+      return frontendArray_;
+    }
+
+    const frontend_array_type& frontend() const
+    {
+      return frontendArray_;
+    }
+
+    backend_array_type& backend()
+    {
+      return outputArray_;
+    }
+
+    const backend_array_type& backend() const
+    {
+      return outputArray_;
+    }
+
+    /** \brief reset the output stage's state for a new frame **/
+    void beginFrame()
+    {
+      dither_.beginFrame();
+    }
+
+    /** \brief tell the output stage where the buffer's content is located in the frame
+     * \param pixelOffset offset of the page's first pixel in the frame, in buffer order
+    **/
+    void beginPage(const size_t& pixelOffset)
+    {
+      pageOffset_ = pixelOffset;
+    }
+
+    /** \brief convert a chunk into the staging array
+     * \return the converted chunk, or 0 if size exceeds the chunk size the buffer was created with
+    **/
+    const uint8_t* makeChunk(const size_t& pixelOffset, const size_t& size)
+    {
+      if (size > outputArray_.size())
+      {
+        return 0;
+      }
+      const frontend_array_type& frontendArray = frontendArray_;
+      dither_.template convert<Conversion>(frontendArray.begin() + pixelOffset, outputArray_.begin(), size, pageOffset_ + pixelOffset);
+      return (const uint8_t*)(outputArray_.data());
+    }
+
+  private:
+    frontend_array_type frontendArray_;
+    backend_array_type outputArray_;
+    Dither dither_;
+    size_t pageOffset_;
+};
+
+
+/** \brief Runtime-sized counterpart of \ref ColorBuffer, with storage taken from an allocator. Only the
+ * interleaved layout is supported.
+**/
+template<typename Display, typename Frontend, typename Conversion, typename Dither>
+class DynamicColorBuffer : public DynamicColorBufferT<Display, Frontend, Conversion, Dither,
+                                                      unconverted_colors<Display, Frontend, Conversion>::value>
+{
+  typedef DynamicColorBufferT<Display, Frontend, Conversion, Dither,
+                              unconverted_colors<Display, Frontend, Conversion>::value> base_type;
+
+  public:
+    template <typename Allocator>
+    DynamicColorBuffer(Allocator& allocator, size_t size, size_t chunkSize, size_t lineLength, size_t alignment = buffer_alignment)
+      : base_type(allocator, size, chunkSize, lineLength, alignment)
+    {
+    }
+};
+
+
+/** \brief a ColorSpan stores colors like the ColorArray of the same color type **/
+template <typename Color>
+struct frontend_storage<color::ColorSpan<Color> >
+  : public std::integral_constant<int, std::is_base_of<color::ColorSpanT<Color, true>, color::ColorSpan<Color> >::value ? 2 : 1>
+{
+};
+
+#endif // SFC_DYNAMICCOLORBUFFER_H
@@ -0,0 +1,265 @@
+#ifndef SFC_DYNAMICPAGEBUFFER_H
+#define SFC_DYNAMICPAGEBUFFER_H
+
+#include <algorithm>
+#include <type_traits>
+
+#include "../color/rgb24.h"
+#include "../geo/bbx.h"
+#include "DynamicColorBuffer.h"
+#include "PageBuffer.h"
+
+/** \brief A Page Buffer with dimensions chosen at runtime
+ *
+ * It is selected with \c sizing_t = sizing::runtime in \ref pageBuffer_traits, and then created by the
+ * \ref OutputManager of a Canvas that was constructed with the dimensions and an allocator. The drawing
+ * functions (see \ref PageBufferBase), slicing, pixel mappings and output stages are those of
+ * \ref PageBuffer, so generic drawing code works with both. The differences are:
+ * - width, height, number of pages and maximum chunk size are constructor arguments, so one binary can
+ *   drive displays of different resolutions. dimensions(), pageCount(), pageCapacity(), framePixels() and
+ *   chunkPixels() return them (PageBuffer provides the same accessors for its compile-time values), and
+ *   the static pages, pixelsPerPage and maxPixelsPerChunk are runtime_size.
+ * - the storage is taken from an allocator (see \ref Arena) with a given alignment, so it can be placed
+ *   in DMA-capable, cache-aligned or huge-page memory. valid() tells whether the allocation succeeded.
+ * - colors are stored interleaved, color::layout::planar is not supported.
+ *
+ * The display type only has to provide \c color_t and \c coordinate_t.
+ * \tparam Display the Display type for which a page buffer is created
+ * \tparam Frontend the frontend type for which a page buffer is created
+**/
+template <typename Display, typename Frontend>
+class DynamicPageBuffer
+  : public PageBufferBase<DynamicPageBuffer<Display, Frontend>, Display, Frontend,
+                          DynamicColorBuffer<Display, Frontend,
+                                             typename pageBuffer_traits<Display, Frontend>::conversion_t,
+                                             typename dither::runtime<typename pageBuffer_traits<Display, Frontend>::dither_t>::type>,
+                          typename page_color<Display, Frontend>::type>
+{
+    typedef PageBufferBase<DynamicPageBuffer<Display, Frontend>, Display, Frontend,
+                           DynamicColorBuffer<Display, Frontend,
+                                              typename pageBuffer_traits<Display, Frontend>::conversion_t,
+                                              typename dither::runtime<typename pageBuffer_traits<Display, Frontend>::dither_t>::type>,
+                           typename page_color<Display, Frontend>::type> base_type;
+
+  public:
+    typedef typename base_type::coordinate_t coordinate_t;
+    typedef typename base_type::point_t point_t;
+    typedef typename base_type::bbx_t bbx_t;
+
+    typedef typename pageBuffer_traits<Display, Frontend>::slicing_t slicing_t;
+    static constexpr bool columns = std::is_same<slicing_t, slicing::columns>::value;
+
+    /** \brief rows that are stored together by the pixel mapping. Rows are padded to a multiple of it. **/
+    static constexpr size_t bankHeight = PixelMapping<Display>::bankHeight;
+
+    /** \brief runtime_size, the values depend on the constructor's arguments, see pageCount(),
+     * pageCapacity() and chunkPixels()
+    **/
+    static constexpr size_t pages = runtime_size;
+    static constexpr size_t pixelsPerPage = runtime_size;
+    static constexpr size_t maxPixelsPerChunk = runtime_size;
+
+    typedef typename pageBuffer_traits<Display, Frontend>::conversion_t conversion_t;
+    typedef typename pageBuffer_traits<Display, Frontend>::dither_t dither_t;
+    typedef typename pageBuffer_traits<Display, Frontend>::layout_t layout_t;
+
+    /** \brief color type of the drawing functions, see \ref page_color **/
+    typedef typename base_type::color_t color_t;
+
+    static_assert(!columns || std::is_same<dither_t, NoDither<Display> >::value,
+                  "DynamicPageBuffer: dithering needs whole rows, so it requires row slicing.");
+    static_assert(std::is_same<layout_t, color::layout::interleaved>::value,
+                  "DynamicPageBuffer: planar layouts are only supported by PageBuffer.");
+
+    typedef typename base_type::color_buffer_t color_buffer_t;
+
+    /** \brief page layout for the constructor's arguments, computed like \ref page_geometry. pages is 0 for
+     * invalid dimensions.
+    **/
+    struct Geometry
+    {
+      Geometry(coordinate_t w, coordinate_t h, size_t requestedPages)
+        : width(w),
+        height(h),
+        pageWidth(0),
+        pageHeight(0),
+        pages(0),
+        pixelsPerPage(0),
+        pixelsPerFrame(0)
+      {
+        if (!width || !height || !requestedPages)
+        {
+          return;
+        }
+        size_t paddedHeight = ((height + bankHeight - 1)/bankHeight)*bankHeight;
+        pageWidth = columns ? (width + requestedPages - 1)/requestedPages : width;
+        pageHeight = columns ? paddedHeight
+          : (((height + requestedPages - 1)/requestedPages + bankHeight - 1)/bankHeight)*bankHeight;
+        pages = columns ? (width + pageWidth - 1)/pageWidth : (height + pageHeight - 1)/pageHeight;
+        pixelsPerPage = pageWidth*pageHeight;
+        pixelsPerFrame = (size_t)width*paddedHeight;
+      }
+
+      coordinate_t width;
+      coordinate_t height;
+      size_t pageWidth;
+      size_t pageHeight;
+      size_t pages;
+      size_t pixelsPerPage;
+      size_t pixelsPerFrame;
+    };
+
+    /** \brief number of bytes an allocator must provide for a buffer with the given dimensions **/
+    static size_t storageSize(coordinate_t width, coordinate_t height, size_t pages, size_t maxPixelsPerChunk,
+                              size_t alignment = buffer_alignment)
+    {
+      Geometry geometry(width, height, pages);
+      return color_buffer_t::storageSize(geometry.pixelsPerPage, maxPixelsPerChunk,
+                                         PixelMapping<Display>::lineLengthOf(geometry.pageWidth), alignment);
+    }
+
+    /** \brief create a page buffer
+     * \param width display width
+     * \param height display height
+     * \param pages number of pages. Pages are as large as necessary (and aligned to the pixel mapping's bank
+     *        height), and the last page may be shorter.
+     * \param maxPixelsPerChunk maximum number of pixels per chunk
+     * \param allocator the allocator that provides the storage, see \ref Arena
+     * \param alignment alignment of the storage, a power of two
+    **/
+    template <typename Allocator>
+    DynamicPageBuffer(coordinate_t width, coordinate_t height, size_t pages, size_t maxPixelsPerChunk,
+                      Allocator& allocator, size_t alignment = buffer_alignment)
+      : base_type(bbx_t(point_t(0, 0), point_t(0, 0)), allocator, Geometry(width, height, pages).pixelsPerPage, maxPixelsPerChunk,
+                  PixelMapping<Display>::lineLengthOf(Geometry(width, height, pages).pageWidth), alignment),
+      geometry_(width, height, pages),
+      maxPixelsPerChunk_(maxPixelsPerChunk)
+    {
+      if (geometry_.pages)
+      {
+        this->bbx_ = pageBbx(geometry_.pages - 1);
+      }
+    }
+
+    /** \brief false if the dimensions are invalid or the allocator couldn't provide the storage **/
+    bool valid() const
+    {
+      return this->buffer_.valid() && geometry_.pages && maxPixelsPerChunk_;
+    }
+
+    /** \brief area covered by a page **/
+    bbx_t pageBbx(size_t page) const
+    {
+      const coordinate_t width = geometry_.width;
+      const coordinate_t height = geometry_.height;
+      return columns
+        ? bbx_t(point_t(page*geometry_.pageWidth, 0), point_t(std::min<size_t>((page + 1)*geometry_.pageWidth, width) - 1, height - 1))
+        : bbx_t(point_t(0, page*geometry_.pageHeight), point_t(width - 1, std::min<size_t>((page + 1)*geometry_.pageHeight, height) - 1));
+    }
+
+    /** \brief index of the page that contains a pixel **/
+    size_t pageOf(coordinate_t x, coordinate_t y) const
+    {
+      return columns ? x/geometry_.pageWidth : y/geometry_.pageHeight;
+    }
+
+    void beginFrame()
+    {
+      this->bbx_ = pageBbx(0);
+      this->buffer_.frontend().fill(color_t(color::RGB24(color::Grayscale<8>(0))));
+      this->buffer_.beginFrame();
+      this->buffer_.beginPage(0);
+    }
+
+    bool ready()
+    {
+      return false;
+    }
+
+    /** \brief get a chunk of the current page for the display
+     * \param offset offset of the chunk's first pixel in the page
+     * \param size number of pixels, at most chunkPixels()
+     * \return the chunk's data, or 0 if size exceeds chunkPixels()
+    **/
+    const uint8_t* makeChunk(const size_t& offset, const size_t& size)
+    {
+      return this->buffer_.makeChunk(offset, size);
+    }
+
+    void update()
+    {
+    }
+
+    /** \brief display dimensions **/
+    point_t dimensions() const {return point_t(geometry_.width, geometry_.height);}
+
+    /** \brief number of pages per frame, which may be less than requested after rounding up the page size **/
+    size_t pageCount() const {return geometry_.pages;}
+
+    /** \brief number of pixels in the current page, in buffer order. Only the last page may have less
+     * than pageCapacity().
+    **/
+    size_t pagePixels() const
+    {
+      size_t rows = this->bbx_.bottom() - this->bbx_.top() + 1;
+      return this->lineWidth()*((rows + bankHeight - 1)/bankHeight)*bankHeight;
+    }
+
+    /** \brief pixels in a full page, the size of the buffer **/
+    size_t pageCapacity() const {return geometry_.pixelsPerPage;}
+
+    /** \brief pixels in a frame, including the padding of a partial bank **/
+    size_t framePixels() const {return geometry_.pixelsPerFrame;}
+
+    /** \brief offset of the current page's first pixel in the frame, in buffer order **/
+    size_t pageOffset() const {return page()*geometry_.pixelsPerPage;}
+
+    /** \brief maximum number of pixels per chunk **/
+    size_t chunkPixels() const {return maxPixelsPerChunk_;}
+
+    /** \brief index of the current page **/
+    size_t page() const {return pageOf(this->bbx_.left(), this->bbx_.top());}
+
+    /** \brief read a pixel at the given point
+     * \param p where to read
+     * \return the color at the given point, or a default-constructed color if p was outside the current bounding box.
+    **/
+    color_t readPixel(const point_t& p) const
+    {
+      if(this->bbx_.contains(p))
+      {
+        return this->buffer_.frontend()[this->index(p)];
+      }
+      return color_t();
+    }
+
+    bool advance()
+    {
+      if (page() + 1 >= geometry_.pages)
+      {
+        return false;
+      }
+      this->bbx_ = pageBbx(page() + 1);
+      this->buffer_.frontend().fill(color_t(color::RGB24(color::Grayscale<8>(0))));
+      this->buffer_.beginPage(pageOffset());
+      return true;
+    }
+
+  private:
+    Geometry geometry_;
+    size_t maxPixelsPerChunk_;
+};
+
+
+/** \brief the page buffer for a display and frontend: \ref PageBuffer, or \ref DynamicPageBuffer if
+ * \c sizing_t in \ref pageBuffer_traits is sizing::runtime
+**/
+template <typename Display, typename Frontend>
+struct page_buffer
+{
+  typedef typename std::conditional<std::is_same<typename pageBuffer_traits<Display, Frontend>::sizing_t, sizing::runtime>::value,
+                                    DynamicPageBuffer<Display, Frontend>,
+                                    PageBuffer<Display, Frontend> >::type type;
+};
+
+#endif // SFC_DYNAMICPAGEBUFFER_H
@@ -1,13 +1,51 @@
 #ifndef SFC_PAGEBUFFER_H
 #define SFC_PAGEBUFFER_H
 
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <type_traits>
+#include <utility>
 
 #include "../color/rgb24.h"
 #include "../geo/bbx.h"
+#include "Blit.h"
 #include "ColorBuffer.h"
+#include "Dither.h"
 #include "PixelMapping.h"
 
+/** \brief Tags for the direction in which a frame is divided into pages **/
+namespace slicing
+{
+  /** \brief pages are bands of rows, from top to bottom **/
+  struct rows {};
+
+
+  /** \brief pages are bands of columns, from left to right. Each page is sent as a window of the
+   * display, e.g. for vertical-byte controllers whose RAM banks span the full width. Frame offsets (as
+   * passed to Display::seek or in a ChunkSegment) count page by page, i.e. page*pixelsPerPage plus the
+   * offset in the page's window.
+  **/
+  struct columns {};
+}
+
+
+/** \brief Tags for how the dimensions of a page buffer are chosen **/
+namespace sizing
+{
+  /** \brief the display's width and height, and the traits' number of pages and chunk size, are compile-time
+   * constants, see \ref PageBuffer
+  **/
+  struct fixed {};
+
+
+  /** \brief width, height, number of pages and chunk size are passed to the Canvas at runtime, and all
+   * storage is taken from an allocator, see \ref DynamicPageBuffer
+  **/
+  struct runtime {};
+}
+
+
 /** \brief traits class for default page buffers.
  * \tparam Display the Display type for which a page buffer is created
 **/
@@ -17,8 +55,37 @@ struct default_pageBuffer_traits
   /** \brief The color type is imported from the display **/
   typedef typename Display::color_t color_t;
 
-  /** \brief The default number of pages is 4 **/
+  /** \brief The default number of pages is 4. The display size doesn't need to be divisible by it;
+   * pages are as large as necessary (and aligned to the pixel mapping's bank height), and the last page
+   * may be shorter.
+  **/
   static constexpr size_t pages = 4;
+
+  /** \brief By default, pages are bands of rows **/
+  typedef slicing::rows slicing_t;
+
+  /** \brief Conversion from frontend to display colors. By default, channels are shifted.
+   * Any other conversion makes the page buffer take the frontend's colors instead of color_t, and is also
+   * applied when frontend and display colors are equal.
+   * \see color::CalibratedConversion
+  **/
+  typedef color::DirectConversion conversion_t;
+
+  /** \brief Output stage used when frontend and display colors differ. By default, channels are truncated.
+   * Any other stage makes the page buffer take the frontend's colors instead of color_t.
+   * \see OrderedDither, FloydSteinbergDither
+  **/
+  typedef NoDither<Display> dither_t;
+
+  /** \brief Memory layout of the buffered colors. color::layout::planar stores RGB colors as channel
+   * planes, see \ref color::PlanarColorArray.
+  **/
+  typedef color::layout::interleaved layout_t;
+
+  /** \brief By default, the dimensions are compile-time constants. sizing::runtime selects a
+   * \ref DynamicPageBuffer, which takes them at runtime; pages and maxPixelsPerChunk are then ignored.
+  **/
+  typedef sizing::fixed sizing_t;
 };
 
 
@@ -32,38 +99,589 @@ struct pageBuffer_traits : public default_pageBuffer_traits<Display>
 };
 
 
+/** \brief color type of a page buffer's drawing functions. An output stage that dithers, or a calibrated
+ * conversion, needs the frontend's precision, so then colors are not quantized to the traits' color_t
+ * before they are stored.
+**/
+template <typename Display, typename Frontend>
+struct page_color
+{
+  typedef typename std::conditional<std::is_same<typename pageBuffer_traits<Display, Frontend>::dither_t, NoDither<Display> >::value
+                                    && std::is_same<typename pageBuffer_traits<Display, Frontend>::conversion_t, color::DirectConversion>::value,
+                                    typename pageBuffer_traits<Display, Frontend>::color_t,
+                                    typename Frontend::color_t>::type type;
+};
+
+
+/** \brief Page layout of a \ref PageBuffer, computed at compile time from the display and the traits **/
+template <typename Display, typename Frontend>
+struct page_geometry
+{
+  typedef typename Display::coordinate_t coordinate_t;
+  static constexpr coordinate_t width = Display::width;
+  static constexpr coordinate_t height = Display::height;
+
+  static constexpr bool columns = std::is_same<typename pageBuffer_traits<Display, Frontend>::slicing_t, slicing::columns>::value;
+
+  /** \brief rows that are stored together by the pixel mapping. Rows are padded to a multiple of it. **/
+  static constexpr size_t bankHeight = PixelMapping<Display>::bankHeight;
+  static constexpr coordinate_t paddedHeight = ((height + bankHeight - 1)/bankHeight)*bankHeight;
+
+  static constexpr size_t requestedPages = pageBuffer_traits<Display, Frontend>::pages;
+  static_assert((requestedPages > 0), "PageBuffer: at least one page is required.");
+
+  /** \brief page size, the last page may be shorter **/
+  static constexpr coordinate_t pageWidth = columns ? (width + requestedPages - 1)/requestedPages : width;
+  static constexpr coordinate_t pageHeight = columns ? paddedHeight
+    : (((height + requestedPages - 1)/requestedPages + bankHeight - 1)/bankHeight)*bankHeight;
+
+  /** \brief actual number of pages, which may be less than requested after rounding up the page size **/
+  static constexpr size_t pages = columns ? (width + pageWidth - 1)/pageWidth : (height + pageHeight - 1)/pageHeight;
+
+  /** \brief pixels in a full page, the size of the buffer **/
+  static constexpr size_t pixelsPerPage = (size_t)pageWidth*pageHeight;
+
+  /** \brief pixels in a frame, including the padding of a partial bank **/
+  static constexpr size_t pixelsPerFrame = (size_t)width*paddedHeight;
+};
+
+
+/** \brief Drawing functions shared by \ref PageBuffer and \ref DynamicPageBuffer
+ *
+ * They only depend on the current page's area, which is known at runtime, so both page buffers have the
+ * same drawing surface.
+ * \tparam Buffer the derived page buffer, which provides page()
+ * \tparam Display the Display type
+ * \tparam Frontend the Frontend type
+ * \tparam ColorBuffer the color buffer that holds the current page
+ * \tparam Color the color type of the drawing functions, see \ref page_color
+**/
+template <typename Buffer, typename Display, typename Frontend, typename ColorBuffer, typename Color>
+class PageBufferBase
+{
+  public:
+    typedef typename Display::coordinate_t coordinate_t;
+    typedef Point<Display> point_t;
+    typedef Bbx<Display> bbx_t;
+    typedef Color color_t;
+    typedef ColorBuffer color_buffer_t;
+
+    /** \brief whether chunks point into the page buffer, see ColorBufferT::inPlace **/
+    static constexpr bool inPlace = color_buffer_t::inPlace;
+
+    /** \brief current bounding box **/
+    bbx_t bbx() {return bbx_;}
+
+    /** \brief draw a pixel, at the given point, with the given color
+     * \param p where to draw the pixel
+     * \param c what color the pixel should have
+     * \return true if the pixel could be drawn, i.e. if it was in the current bounding box
+    **/
+    bool drawPixel(const point_t& p, const color_t& c)
+    {
+      return drawPixel(p, c, bbx_);
+    }
+
+    /** \brief draw the current page's bucket of a \ref PixelBatch
+     *
+     * Buffer indices are computed for a block of pixels first, in a loop without dependencies that the
+     * compiler can vectorize, and then the colors are scattered into the buffer.
+     * \param batch the batch, which must have been bucketed
+    **/
+    template <typename Batch>
+    void drawPixels(const Batch& batch)
+    {
+      static constexpr size_t block = 64;
+      const size_t page = static_cast<const Buffer*>(this)->page();
+      size_t first = batch.pageBegin(page);
+      size_t last = batch.pageEnd(page);
+      const coordinate_t* x = batch.x();
+      const coordinate_t* y = batch.y();
+      const typename Batch::color_t* c = batch.colors();
+      const size_t top = bbx_.top();
+      const size_t left = bbx_.left();
+      const size_t stride = lineWidth();
+      size_t indices[block];
+      for (size_t i = first; i < last; i += block)
+      {
+        size_t n = std::min(block, last - i);
+        for (size_t j = 0; j < n; j++)
+        {
+          indices[j] = PixelMapping<Display>::map(x[i + j] - left, y[i + j] - top, stride);
+        }
+        for (size_t j = 0; j < n; j++)
+        {
+          buffer_.frontend()[indices[j]] = c[i + j];
+        }
+      }
+    }
+
+    /** \brief set every pixel of an area to the value of a functor, clipped to the current page
+     *
+     * The area is traversed in the PixelMapping's buffer order, so the loop around the (inlined) functor
+     * has sequential stores.
+     * \param area the area to fill
+     * \param f called as f(x, y) for every pixel, must return something that can be assigned to color_t
+    **/
+    template <typename F>
+    void generate(const bbx_t& area, F&& f)
+    {
+      generate(area, std::forward<F>(f), bbx_);
+    }
+
+    /** \brief fill a horizontal span of pixels, clipped to the current bounding box
+     * \param p the span's leftmost pixel
+     * \param length number of pixels
+     * \param c what color the pixels should have
+    **/
+    void fillSpan(const point_t& p, coordinate_t length, const color_t& c)
+    {
+      fillSpan(p, length, c, bbx_);
+    }
+
+    /** \brief draw a streamed image, decoding only the rows that intersect the current page
+     * \param origin where the image's upper left pixel is drawn
+     * \param img the image, see \ref image::Image
+    **/
+    template <typename Image>
+    void drawImage(const point_t& origin, const Image& img)
+    {
+      drawImage(origin, img, bbx_);
+    }
+
+    /** \brief combine a packed bitmap with the current page, word by word, see \ref Blit.h. The bitmap is
+     * clipped to the page. Only available for packed frontend colors (less than 8 bits).
+     * \tparam Op the raster operation, e.g. raster::rop::Xor
+     * \param origin where the bitmap's upper left pixel goes
+     * \param bitmap the bitmap, in the frontend colors' pixel format and this display's pixel mapping
+    **/
+    template <typename Op = raster::rop::Copy>
+    void blit(const point_t& origin, const raster::Bitmap& bitmap)
+    {
+      blit<Op>(origin, bitmap, bbx_);
+    }
+
+    /** \brief A band of rows of the current page, see bands(). It has the page buffer's drawing functions,
+     * clipped to the band.
+    **/
+    class Band
+    {
+      public:
+        Band()
+          : buffer_(0)
+        {
+        }
+
+        /** \brief area of the band **/
+        const bbx_t& bbx() const
+        {
+          return bbx_;
+        }
+
+        bool drawPixel(const point_t& p, const color_t& c)
+        {
+          return buffer_->drawPixel(p, c, bbx_);
+        }
+
+        template <typename F>
+        void generate(const bbx_t& area, F&& f)
+        {
+          buffer_->generate(area, std::forward<F>(f), bbx_);
+        }
+
+        void fillSpan(const point_t& p, coordinate_t length, const color_t& c)
+        {
+          buffer_->fillSpan(p, length, c, bbx_);
+        }
+
+        template <typename Image>
+        void drawImage(const point_t& origin, const Image& img)
+        {
+          buffer_->drawImage(origin, img, bbx_);
+        }
+
+        template <typename Op = raster::rop::Copy>
+        void blit(const point_t& origin, const raster::Bitmap& bitmap)
+        {
+          buffer_->template blit<Op>(origin, bitmap, bbx_);
+        }
+
+      private:
+        friend class PageBufferBase;
+
+        Band(PageBufferBase* buffer, const bbx_t& bbx)
+          : buffer_(buffer), bbx_(bbx)
+        {
+        }
+
+        PageBufferBase* buffer_;
+        bbx_t bbx_;
+    };
+
+    /** \brief split the current page into bands of rows that several threads may draw into at the same time
+     *
+     * The page buffer is not thread-safe, but its drawing functions only write the pixels they draw. With
+     * packed frontend colors, writing a pixel reads and writes its whole storage word, so two threads that
+     * draw neighbouring pixels of one word would lose each other's writes. The bands therefore start at
+     * storage word boundaries (and at the pixel mapping's bank boundaries), so no two bands share a word.
+     * Each thread draws through its own Band, which clips to it; the page must not change, i.e.
+     * OutputManager::update() must not be called, until all threads are done:
+     * \code
+     * typename buffer_t::Band bands[4];
+     * size_t n = buffer.bands(4, bands);
+     * std::vector<std::thread> threads;
+     * for (size_t i = 0; i < n; i++)
+     * {
+     *   threads.emplace_back([&bands, i]() { bands[i].drawImage(origin, image); });
+     * }
+     * for (auto& t : threads)
+     * {
+     *   t.join();
+     * }
+     * \endcode
+     * \param count the number of bands wanted
+     * \param bands receives the bands, from top to bottom
+     * \return the number of bands, less than count if the page has fewer rows than that (in multiples of
+     *         the alignment)
+    **/
+    size_t bands(size_t count, Band* bands)
+    {
+      size_t rows = bbx_.bottom() - bbx_.top() + 1;
+      size_t unit = bandRows();
+      size_t units = (rows + unit - 1)/unit;
+      size_t n = std::min(count, units);
+      for (size_t i = 0; i < n; i++)
+      {
+        size_t first = bbx_.top() + unit*(i*units/n);
+        size_t last = std::min<size_t>(bbx_.top() + unit*((i + 1)*units/n), bbx_.bottom() + 1) - 1;
+        bands[i] = Band(this, bbx_t(point_t(bbx_.left(), first), point_t(bbx_.right(), last)));
+      }
+      return n;
+    }
+
+    /** \brief move the content of an area within the current page
+     *
+     * The page buffer only holds the current page, so a pixel keeps its content only if its source
+     * (p - (dx, dy)) lies in the area's part of this page. All other pixels of the area in this page,
+     * i.e. the strip that is scrolled in and content that would come from another page, are exposed and
+     * cleared, and must be drawn again. Rows are moved with block copies (bit-shifted copies for packed
+     * colors) if the pixel mapping stores rows contiguously, and pixel by pixel otherwise.
+     * \param area the area to scroll
+     * \param dx horizontal distance, positive to the right
+     * \param dy vertical distance, positive downwards
+    **/
+    void scroll(const bbx_t& area, int dx, int dy)
+    {
+      bbx_t clipped = area.intersect(bbx_);
+      if (!clipped.valid())
+      {
+        return;
+      }
+      const int left = clipped.left();
+      const int right = clipped.right();
+      const int top = clipped.top();
+      const int bottom = clipped.bottom();
+      const int x0 = std::max(left, left + dx);
+      const int x1 = std::min(right, right + dx);
+      for (int k = 0; k <= bottom - top; k++)
+      {
+        int y = (dy > 0) ? bottom - k : top + k;
+        int sy = y - dy;
+        if ((sy < top) || (sy > bottom) || (x0 > x1))
+        {
+          clearRun(y, left, right);
+          continue;
+        }
+        moveRun(y, sy, x0, x1, dx, run_copy_t());
+        clearRun(y, left, x0 - 1);
+        clearRun(y, x1 + 1, right);
+      }
+    }
+
+  protected:
+    /** \brief create the base of a page buffer
+     * \param bbx the initial bounding box
+     * \param args the color buffer's constructor arguments
+    **/
+    template <typename... Args>
+    PageBufferBase(const bbx_t& bbx, Args&&... args)
+      : bbx_(bbx),
+      buffer_(std::forward<Args>(args)...)
+    {
+    }
+
+    /** \brief number of columns in the current page's buffer **/
+    size_t lineWidth() const
+    {
+      return bbx_.right() - bbx_.left() + 1;
+    }
+
+    /** \brief buffer index of a point in the current page **/
+    size_t index(const point_t& p) const
+    {
+      return PixelMapping<Display>::map(p.x() - bbx_.left(), p.y() - bbx_.top(), lineWidth());
+    }
+
+    bbx_t bbx_;
+    color_buffer_t buffer_;
+
+  private:
+    typedef typename color_buffer_t::frontend_array_type frontend_array_type;
+    typedef typename Frontend::color_t frontend_color_t;
+
+    /** \brief how scroll() copies a run of a row: 0 pixel by pixel, 1 as elements, 2 as packed bits **/
+    typedef std::integral_constant<int, (PixelMapping<Display>::xStride != 1) ? 0 : frontend_storage<frontend_array_type>::value> run_copy_t;
+
+    /** \brief number of rows at whose multiples a band starts at a storage word and bank boundary **/
+    size_t bandRows() const
+    {
+      size_t rows = PixelMapping<Display>::bankHeight;
+      if (frontend_storage<frontend_array_type>::value == 2)
+      {
+        static constexpr size_t bits = color::colorRepresentation_traits<frontend_color_t>::storage_bit_size;
+        const size_t wordBits = 8*sizeof(*buffer_.frontend().data());
+        while ((bits*PixelMapping<Display>::map(0, rows, lineWidth())) % wordBits)
+        {
+          rows += PixelMapping<Display>::bankHeight;
+        }
+      }
+      return rows;
+    }
+
+    bool drawPixel(const point_t& p, const color_t& c, const bbx_t& clip)
+    {
+      if (clip.contains(p))
+      {
+        buffer_.frontend()[index(p)] = c;
+        return true;
+      }
+      return false;
+    }
+
+    template <typename F>
+    void generate(const bbx_t& area, F&& f, const bbx_t& clip)
+    {
+      bbx_t clipped = area.intersect(clip);
+      if (!clipped.valid())
+      {
+        return;
+      }
+      const size_t top = bbx_.top();
+      const size_t left = bbx_.left();
+      auto& frontend = buffer_.frontend();
+      PixelMapping<Display>::forEach(clipped.left() - left, clipped.right() - left, clipped.top() - top, clipped.bottom() - top,
+                                     [&](size_t x, size_t y, size_t i)
+                                     {
+                                       frontend[i] = f(x + left, y + top);
+                                     },
+                                     lineWidth());
+    }
+
+    void fillSpan(const point_t& p, coordinate_t length, const color_t& c, const bbx_t& clip)
+    {
+      if ((p.y() < clip.top()) || (p.y() > clip.bottom()) || (p.x() > clip.right()) || (length == 0))
+      {
+        return;
+      }
+      coordinate_t x0 = std::max(p.x(), clip.left());
+      coordinate_t x1 = std::min<size_t>(p.x() + length - 1, clip.right());
+      if (x1 < x0)
+      {
+        return;
+      }
+      size_t i = index(point_t(x0, p.y()));
+      for (coordinate_t x = x0; x <= x1; x++, i += PixelMapping<Display>::xStride)
+      {
+        buffer_.frontend()[i] = c;
+      }
+    }
+
+    template <typename Image>
+    void drawImage(const point_t& origin, const Image& img, const bbx_t& clip)
+    {
+      if ((origin.y() > clip.bottom()) || (origin.y() + img.height() <= clip.top()))
+      {
+        return;
+      }
+      size_t first = std::max(origin.y(), clip.top()) - origin.y();
+      size_t last = std::min<size_t>(origin.y() + img.height() - 1, clip.bottom()) - origin.y();
+      img.decode(first, last,
+                 [&](size_t x, size_t y, size_t length, const color::RGB24& c)
+                 {
+                   fillSpan(point_t(origin.x() + x, origin.y() + y), length, color_t(c), clip);
+                 });
+    }
+
+    template <typename Op>
+    void blit(const point_t& origin, const raster::Bitmap& bitmap, const bbx_t& clip)
+    {
+      static constexpr size_t bits = color::colorRepresentation_traits<frontend_color_t>::storage_bit_size;
+      static_assert(bits % 8 != 0, "PageBuffer::blit: the frontend colors must be packed, i.e. less than 8 bits");
+      if ((bitmap.width == 0) || (bitmap.height == 0))
+      {
+        return;
+      }
+      bbx_t clipped = bbx_t(origin, point_t(origin.x() + bitmap.width - 1, origin.y() + bitmap.height - 1)).intersect(clip);
+      if (!clipped.valid())
+      {
+        return;
+      }
+      raster::blit<PixelMapping<Display>, bits, Op>(buffer_.frontend().data(), lineWidth(),
+                                                    clipped.left() - bbx_.left(), clipped.top() - bbx_.top(),
+                                                    bitmap, clipped.left() - origin.x(), clipped.top() - origin.y(),
+                                                    clipped.right() - clipped.left() + 1, clipped.bottom() - clipped.top() + 1);
+    }
+
+    /** \brief clear the pixels x0..x1 of row y **/
+    void clearRun(int y, int x0, int x1)
+    {
+      for (int x = x0; x <= x1; x++)
+      {
+        buffer_.frontend()[index(point_t(x, y))] = color_t(color::RGB24(color::Grayscale<8>(0)));
+      }
+    }
+
+    /** \brief copy the pixels x0-dx..x1-dx of row sy to x0..x1 of row y, pixel by pixel **/
+    void moveRun(int y, int sy, int x0, int x1, int dx, std::integral_constant<int, 0>)
+    {
+      const frontend_array_type& frontend = buffer_.frontend();
+      for (int k = 0; k <= x1 - x0; k++)
+      {
+        int x = (dx > 0) ? x1 - k : x0 + k;
+        buffer_.frontend()[index(point_t(x, y))] = frontend[index(point_t(x - dx, sy))];
+      }
+    }
+
+    /** \brief copy a run of contiguous elements, like memmove **/
+    void moveRun(int y, int sy, int x0, int x1, int dx, std::integral_constant<int, 1>)
+    {
+      frontend_color_t* data = buffer_.frontend().data();
+      frontend_color_t* src = data + index(point_t(x0 - dx, sy));
+      frontend_color_t* dst = data + index(point_t(x0, y));
+      size_t n = x1 - x0 + 1;
+      if (dst < src)
+      {
+        std::copy(src, src + n, dst);
+      }
+      else
+      {
+        std::copy_backward(src, src + n, dst + n);
+      }
+    }
+
+    /** \brief copy a run of packed bits, like memmove: pieces of it go through a small staging copy, in the
+     * order that reads every source bit before it is overwritten
+    **/
+    void moveRun(int y, int sy, int x0, int x1, int dx, std::integral_constant<int, 2>)
+    {
+      static constexpr size_t bits = color::colorRepresentation_traits<frontend_color_t>::storage_bit_size;
+      static constexpr size_t pieceBits = 256;
+      uint8_t piece[pieceBits/8];
+      auto* words = buffer_.frontend().data();
+      const size_t src = bits*index(point_t(x0 - dx, sy));
+      const size_t dst = bits*index(point_t(x0, y));
+      const size_t n = bits*(x1 - x0 + 1);
+      for (size_t done = 0; done < n; done += pieceBits)
+      {
+        size_t take = std::min(pieceBits, n - done);
+        size_t offset = (dst < src) ? done : n - done - take;
+        raster::blitBits<raster::rop::Copy>(piece, 0, (const uint8_t*)words, 0, src + offset, take);
+        raster::blitBits<raster::rop::Copy>(words, dst + offset, piece, 0, 0, take);
+      }
+    }
+};
+
+
 /** \brief A Generic Page Buffer
  *
  * The Page Buffer is created by an \ref OutputDispatcher for a canvas that draws on a buffered display.
+ * Its drawing functions are those of \ref PageBufferBase.
  * \tparam Display the Display type for which a page buffer is created
  * \tparam Frontend the frontend type for which a page buffer is created
 **/
 template <typename Display, typename Frontend>
 class PageBuffer
+  : public PageBufferBase<PageBuffer<Display, Frontend>, Display, Frontend,
+                          ColorBuffer<Display, Frontend, page_geometry<Display, Frontend>::pixelsPerPage,
+                                      pageBuffer_traits<Display, Frontend>::maxPixelsPerChunk,
+                                      typename pageBuffer_traits<Display, Frontend>::conversion_t,
+                                      typename pageBuffer_traits<Display, Frontend>::dither_t,
+                                      typename pageBuffer_traits<Display, Frontend>::layout_t>,
+                          typename page_color<Display, Frontend>::type>
 {
+    typedef PageBufferBase<PageBuffer<Display, Frontend>, Display, Frontend,
+                           ColorBuffer<Display, Frontend, page_geometry<Display, Frontend>::pixelsPerPage,
+                                       pageBuffer_traits<Display, Frontend>::maxPixelsPerChunk,
+                                       typename pageBuffer_traits<Display, Frontend>::conversion_t,
+                                       typename pageBuffer_traits<Display, Frontend>::dither_t,
+                                       typename pageBuffer_traits<Display, Frontend>::layout_t>,
+                           typename page_color<Display, Frontend>::type> base_type;
+    typedef page_geometry<Display, Frontend> geometry_t;
+
   public:
     // Display concept types
-    typedef typename Display::coordinate_t coordinate_t;
-    typedef Point<Display> point_t;
-    typedef Bbx<Display> bbx_t;
-    typedef typename pageBuffer_traits<Display, Frontend>::color_t color_t;
-    static constexpr coordinate_t width = Display::width;
-    static constexpr coordinate_t height = Display::height;
-
-    static constexpr size_t pages = pageBuffer_traits<Display, Frontend>::pages;
-    static_assert(((height % pages) == 0), "PageBuffer: Device height must be integer divisable by the number of pages.");
-    static constexpr coordinate_t pageHeight = height/pages;
-    static constexpr size_t pixelsPerPage = width*pageHeight;
+    typedef typename base_type::coordinate_t coordinate_t;
+    typedef typename base_type::point_t point_t;
+    typedef typename base_type::bbx_t bbx_t;
+    static constexpr coordinate_t width = geometry_t::width;
+    static constexpr coordinate_t height = geometry_t::height;
+
+    typedef typename pageBuffer_traits<Display, Frontend>::slicing_t slicing_t;
+    static constexpr bool columns = geometry_t::columns;
+
+    /** \brief rows that are stored together by the pixel mapping. Rows are padded to a multiple of it. **/
+    static constexpr size_t bankHeight = geometry_t::bankHeight;
+    static constexpr coordinate_t paddedHeight = geometry_t::paddedHeight;
+
+    static constexpr size_t requestedPages = geometry_t::requestedPages;
+
+    /** \brief page size, the last page may be shorter **/
+    static constexpr coordinate_t pageWidth = geometry_t::pageWidth;
+    static constexpr coordinate_t pageHeight = geometry_t::pageHeight;
+
+    /** \brief actual number of pages, which may be less than requested after rounding up the page size **/
+    static constexpr size_t pages = geometry_t::pages;
+
+    /** \brief pixels in a full page, the size of the buffer **/
+    static constexpr size_t pixelsPerPage = geometry_t::pixelsPerPage;
+
+    /** \brief pixels in a frame, including the padding of a partial bank **/
+    static constexpr size_t pixelsPerFrame = geometry_t::pixelsPerFrame;
 //    static constexpr size_t bytesPerPage = (color::colorRepresentation_traits<color_t>::storage_bit_size*pixelsPerPage)/8;
     static constexpr size_t maxPixelsPerChunk = pageBuffer_traits<Display, Frontend>::maxPixelsPerChunk;
 
-    typedef ColorBuffer<Display, Frontend, pixelsPerPage, maxPixelsPerChunk> color_buffer_t;
+    typedef typename pageBuffer_traits<Display, Frontend>::conversion_t conversion_t;
+    typedef typename pageBuffer_traits<Display, Frontend>::dither_t dither_t;
+
+    /** \brief color type of the drawing functions, see \ref page_color **/
+    typedef typename base_type::color_t color_t;
+
+    static_assert(!columns || std::is_same<dither_t, NoDither<Display> >::value,
+                  "PageBuffer: dithering needs whole rows, so it requires row slicing.");
+
+    typedef typename pageBuffer_traits<Display, Frontend>::layout_t layout_t;
+
+    typedef typename base_type::color_buffer_t color_buffer_t;
 
     PageBuffer()
-      : bbx_(point_t(0,height-pageHeight),point_t(width-1, height-1))
+      : base_type(pageBbx(pages - 1))
     {
     }
 
+    /** \brief area covered by a page **/
+    static bbx_t pageBbx(size_t page)
+    {
+      return columns
+        ? bbx_t(point_t(page*pageWidth, 0), point_t(std::min<size_t>((page + 1)*pageWidth, width) - 1, height - 1))
+        : bbx_t(point_t(0, page*pageHeight), point_t(width - 1, std::min<size_t>((page + 1)*pageHeight, height) - 1));
+    }
+
+    /** \brief index of the page that contains a pixel **/
+    static size_t pageOf(coordinate_t x, coordinate_t y)
+    {
+      return columns ? x/pageWidth : y/pageHeight;
+    }
+
 //    void resetPage()
 //    {
 //      bytesLeftInPage_ = bytesPerPage;
@@ -71,8 +689,10 @@ class PageBuffer
 
     void beginFrame()
     {
-      bbx_ = bbx_t(point_t(0,0),point_t(width-1, pageHeight-1));
-      buffer_.frontend().fill(color_t(color::RGB24(color::Grayscale<8>(0))));
+      this->bbx_ = pageBbx(0);
+      this->buffer_.frontend().fill(color_t(color::RGB24(color::Grayscale<8>(0))));
+      this->buffer_.beginFrame();
+      this->buffer_.beginPage(0);
 //      resetPage();
     }
 
@@ -84,7 +704,7 @@ class PageBuffer
 
     const uint8_t* makeChunk(const size_t& offset, const size_t& size)
     {
-      return buffer_.makeChunk(offset, size);
+      return this->buffer_.makeChunk(offset, size);
     }
 
     /** \brief do something - whatever is necessary
@@ -107,36 +727,48 @@ class PageBuffer
 //      }
     }
 
+    /** \brief always true, for code shared with \ref DynamicPageBuffer **/
+    bool valid() const {return true;}
+
     /** \brief overall dimensions of the device area **/
-//    point_t dimensions() const {return display_.dimensions();}
+    point_t dimensions() const {return point_t(width, height);}
 
-    /** \brief current bounding box **/
-    bbx_t bbx() {return bbx_;}
+    /** \brief number of pages per frame, for code shared with \ref DynamicPageBuffer **/
+    size_t pageCount() const {return pages;}
 
-    /** \brief draw a pixel, at the given point, with the given color
-     * \param p where to draw the pixel
-     * \param c what color the pixel should have
-     * \return true if the pixel could be drawn, i.e. if it was in the current bounding box
+    /** \brief number of pixels in the current page, in buffer order. Only the last page may have less
+     * than pixelsPerPage.
     **/
-    bool drawPixel(const point_t& p, const color_t& c)
+    size_t pagePixels() const
     {
-      if (bbx_.contains(p))
-      {
-        buffer_.frontend()[mapPixel(p)] = c;
-        return true;
-      }
-      return false;
+      size_t rows = this->bbx_.bottom() - this->bbx_.top() + 1;
+      return this->lineWidth()*((rows + bankHeight - 1)/bankHeight)*bankHeight;
     }
 
+    /** \brief pixels in a full page, for code shared with \ref DynamicPageBuffer **/
+    size_t pageCapacity() const {return pixelsPerPage;}
+
+    /** \brief pixels in a frame, for code shared with \ref DynamicPageBuffer **/
+    size_t framePixels() const {return pixelsPerFrame;}
+
+    /** \brief offset of the current page's first pixel in the frame, in buffer order **/
+    size_t pageOffset() const {return page()*pixelsPerPage;}
+
+    /** \brief maximum number of pixels per chunk, for code shared with \ref DynamicPageBuffer **/
+    size_t chunkPixels() const {return maxPixelsPerChunk;}
+
+    /** \brief index of the current page **/
+    size_t page() const {return pageOf(this->bbx_.left(), this->bbx_.top());}
+
     /** \brief read a pixel at the given point
      * \param p where to read
      * \return the color at the given point, or a default-constructed color if p was outside the current bounding box.
     **/
     color_t readPixel(const point_t& p) const
     {
-      if(bbx_.contains(p))
+      if(this->bbx_.contains(p))
       {
-        return buffer_.frontend()[mapPixel<Display>(p)];
+        return this->buffer_.frontend()[this->index(p)];
       }
       std::cout << "read out of range\n";
       return color_t();
@@ -144,12 +776,13 @@ class PageBuffer
 
     bool advance()
     {
-      if (bbx_.bottom() == (height-1))
+      if (page() == (pages-1))
       {
         return false;
       }
-      bbx_.p0 += point_t(0, pageHeight);
-      bbx_.p1 += point_t(0, pageHeight);
+      this->bbx_ = pageBbx(page() + 1);
+      this->buffer_.frontend().fill(color_t(color::RGB24(color::Grayscale<8>(0))));
+      this->buffer_.beginPage(pageOffset());
 //      resetPage();
       return true;
 
@@ -160,12 +793,6 @@ class PageBuffer
 //      return display_;
 //    }
 //
-  private:
-    bbx_t bbx_;
-//    size_t bytesLeftInPage_;
-//    Display& display_;
-
-    color_buffer_t buffer_;
 };
 
 #endif // SFC_PAGEBUFFER_H
@@ -0,0 +1,238 @@
+#ifndef SFC_PIXELBATCH_H
+#define SFC_PIXELBATCH_H
+
+#include <array>
+#include <type_traits>
+
+#include "Arena.h"
+#include "DynamicPageBuffer.h"
+
+/** \brief A batch of pixels, stored as structure of arrays and bucketed by page
+ *
+ * Drawing many single pixels through Canvas::drawPixel repeats the bounding box check and the pixel
+ * mapping for every pixel on every page pass. A PixelBatch is filled once per frame. Before the first
+ * page pass it is sorted into one bucket per page (a counting sort that permutes the arrays in place),
+ * and every page pass then only touches the pixels of its own bucket.
+ *
+ * Pixels outside the display are dropped when the batch is bucketed.
+ *
+ * A batch for a \ref DynamicPageBuffer keeps its buckets in storage taken from an allocator, see
+ * PixelBatch(const page_buffer_t&, Allocator&, size_t).
+ *
+ * \tparam Display the Display type
+ * \tparam Frontend the Frontend type
+ * \tparam Capacity maximum number of pixels in the batch
+**/
+template <typename Display, typename Frontend, size_t Capacity>
+class PixelBatch
+{
+  public:
+    typedef typename page_buffer<Display, Frontend>::type page_buffer_t;
+    typedef typename page_buffer_t::coordinate_t coordinate_t;
+    typedef typename page_buffer_t::color_t color_t;
+
+    /** \brief index type, as small as the capacity allows **/
+    typedef typename std::conditional<(Capacity <= 0xFFFF), uint16_t, uint32_t>::type index_type;
+
+    static constexpr size_t capacity = Capacity;
+    /** \brief number of pages, runtime_size for a \ref DynamicPageBuffer **/
+    static constexpr size_t pages = page_buffer_t::pages;
+
+    PixelBatch()
+      : size_(0),
+      bucketed_(false)
+    {
+    }
+
+    /** \brief create a batch for a \ref DynamicPageBuffer, with the buckets' storage taken from an allocator
+     * \param buffer the page buffer the batch is drawn into
+     * \param allocator the allocator, see \ref Arena
+     * \param alignment alignment of the storage
+    **/
+    template <typename Allocator>
+    PixelBatch(const page_buffer_t& buffer, Allocator& allocator, size_t alignment = buffer_alignment)
+      : size_(0),
+      bucketed_(false)
+    {
+      start_.allocate(allocator, buffer.pageCount() + 3, alignment);
+    }
+
+    /** \brief number of bytes an allocator must provide for a batch drawn into a \ref DynamicPageBuffer **/
+    static size_t storageSize(const page_buffer_t& buffer, size_t alignment = buffer_alignment)
+    {
+      return start_t::storageSize(buffer.pageCount() + 3, alignment);
+    }
+
+    /** \brief false if the allocator couldn't provide the buckets' storage **/
+    bool valid() const
+    {
+      return start_.size() != 0;
+    }
+
+    /** \brief append a pixel
+     * \return false if the batch is full
+    **/
+    bool push(coordinate_t x, coordinate_t y, const color_t& c)
+    {
+      if (size_ == Capacity)
+      {
+        return false;
+      }
+      x_[size_] = x;
+      y_[size_] = y;
+      colors_[size_] = c;
+      size_++;
+      bucketed_ = false;
+      return true;
+    }
+
+    /** \brief remove all pixels **/
+    void clear()
+    {
+      size_ = 0;
+      bucketed_ = false;
+    }
+
+    /** \brief set the number of pixels, for filling the arrays directly via x(), y() and colors() **/
+    void resize(size_t size)
+    {
+      size_ = std::min(size, Capacity);
+      bucketed_ = false;
+    }
+
+    size_t size() const
+    {
+      return size_;
+    }
+
+    /** \brief x coordinates. Non-const access invalidates the buckets. **/
+    coordinate_t* x()
+    {
+      bucketed_ = false;
+      return x_.data();
+    }
+
+    const coordinate_t* x() const
+    {
+      return x_.data();
+    }
+
+    /** \brief y coordinates. Non-const access invalidates the buckets. **/
+    coordinate_t* y()
+    {
+      bucketed_ = false;
+      return y_.data();
+    }
+
+    const coordinate_t* y() const
+    {
+      return y_.data();
+    }
+
+    /** \brief colors. Non-const access invalidates the buckets. **/
+    color_t* colors()
+    {
+      bucketed_ = false;
+      return colors_.data();
+    }
+
+    const color_t* colors() const
+    {
+      return colors_.data();
+    }
+
+    bool bucketed() const
+    {
+      return bucketed_;
+    }
+
+    /** \brief sort the pixels by page, if this has not been done since the last modification **/
+    void bucket()
+    {
+      static_assert(pages != runtime_size, "PixelBatch: a batch for a DynamicPageBuffer is bucketed with bucket(buffer).");
+      bucket(pages, page_buffer_t::width, page_buffer_t::height,
+             [](coordinate_t x, coordinate_t y) { return page_buffer_t::pageOf(x, y); });
+    }
+
+    /** \brief sort the pixels by the pages of a page buffer, if this has not been done since the last
+     * modification
+     * \param buffer the page buffer the batch is drawn into. A batch for a \ref DynamicPageBuffer must have
+     *        been created for it.
+    **/
+    void bucket(const page_buffer_t& buffer)
+    {
+      bucket(buffer.pageCount(), buffer.dimensions().x(), buffer.dimensions().y(),
+             [&buffer](coordinate_t x, coordinate_t y) { return buffer.pageOf(x, y); });
+    }
+
+    /** \brief index of a page's first pixel, valid after bucket() **/
+    size_t pageBegin(size_t page) const
+    {
+      return start_[page];
+    }
+
+    /** \brief index after a page's last pixel, valid after bucket() **/
+    size_t pageEnd(size_t page) const
+    {
+      return start_[page + 1];
+    }
+
+  private:
+    /** \brief bucket start indices, one more than the pages and the extra bucket need, see bucket() **/
+    typedef StorageArray<size_t, (pages == runtime_size) ? runtime_size : pages + 3> start_t;
+
+    template <typename PageOf>
+    void bucket(size_t pageCount, coordinate_t width, coordinate_t height, PageOf pageOf)
+    {
+      if (bucketed_)
+      {
+        return;
+      }
+      // count pixels per page, invalid pixels go to the extra bucket
+      std::fill(start_.begin(), start_.end(), 0);
+      for (size_t i = 0; i < size_; i++)
+      {
+        start_[bucketOf(i, pageCount, width, height, pageOf) + 2]++;
+      }
+      for (size_t p = 2; p < pageCount + 3; p++)
+      {
+        start_[p] += start_[p - 1];
+      }
+      // start_[p + 1] is now the first index of page p. It serves as the page's next destination, and
+      // ends up as its end, i.e. start_[p] is the first index of page p again.
+      for (size_t i = 0; i < size_; i++)
+      {
+        dest_[i] = start_[bucketOf(i, pageCount, width, height, pageOf) + 1]++;
+      }
+      // apply the permutation cycle by cycle
+      for (size_t i = 0; i < size_; i++)
+      {
+        while (dest_[i] != i)
+        {
+          size_t j = dest_[i];
+          std::swap(x_[i], x_[j]);
+          std::swap(y_[i], y_[j]);
+          std::swap(colors_[i], colors_[j]);
+          std::swap(dest_[i], dest_[j]);
+        }
+      }
+      bucketed_ = true;
+    }
+
+    /** \brief the bucket of a pixel: its page, or pageCount if it is outside the display **/
+    template <typename PageOf>
+    size_t bucketOf(size_t i, size_t pageCount, coordinate_t width, coordinate_t height, PageOf& pageOf) const
+    {
+      return ((x_[i] < width) && (y_[i] < height)) ? pageOf(x_[i], y_[i]) : pageCount;
+    }
+
+    std::array<coordinate_t, Capacity> x_;
+    std::array<coordinate_t, Capacity> y_;
+    std::array<color_t, Capacity> colors_;
+    std::array<index_type, Capacity> dest_;
+    start_t start_;
+    size_t size_;
+    bool bucketed_;
+};
+
+#endif // SFC_PIXELBATCH_H
@@ -1,13 +1,77 @@
 #ifndef SFC_PIXELMAPPING_H
 #define SFC_PIXELMAPPING_H
 
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+/** \brief Display::width, or 0 for a display whose width is only known at runtime, see \ref DynamicPageBuffer **/
+template <typename Display, typename = void>
+struct static_width : public std::integral_constant<size_t, 0>
+{
+};
+
+template <typename Display>
+struct static_width<Display, decltype((void)Display::width)> : public std::integral_constant<size_t, Display::width>
+{
+};
+
+
 /** Default pixel mapping **/
 template<typename Display>
 struct LinearXYPixelMapping
 {
+  /** \brief number of consecutive buffer elements that form one line in the mapping's native order, 0 if
+   * the display's width is only known at runtime
+  **/
+  static constexpr size_t lineLength = static_width<Display>::value;
+
+  /** \brief line length in a buffer of the given number of columns **/
+  static size_t lineLengthOf(size_t width)
+  {
+    return width;
+  }
+
+  /** \brief distance in the buffer between two horizontally adjacent pixels **/
+  static constexpr size_t xStride = 1;
+
+  /** \brief number of rows that are stored together; pages start at multiples of this **/
+  static constexpr size_t bankHeight = 1;
+
   static size_t map(const Point<Display>& p)
   {
-    return p.y()*Display::width + p.x();
+    return map(p.x(), p.y());
+  }
+
+  /** \brief map plain coordinates, for bulk operations on coordinate arrays
+   * \param x column
+   * \param y row
+   * \param width number of columns in the buffer, less than the display width for column pages
+  **/
+  static size_t map(size_t x, size_t y, size_t width = Display::width)
+  {
+    return y*width + x;
+  }
+
+  /** \brief visit all pixels of a rectangle in buffer order, row by row
+   * \param x0 left column
+   * \param x1 right column (inclusive)
+   * \param y0 top row
+   * \param y1 bottom row (inclusive)
+   * \param f called as f(x, y, index)
+   * \param width number of columns in the buffer
+  **/
+  template <typename F>
+  static void forEach(size_t x0, size_t x1, size_t y0, size_t y1, F&& f, size_t width = Display::width)
+  {
+    for (size_t y = y0; y <= y1; y++)
+    {
+      size_t i = map(x0, y, width);
+      for (size_t x = x0; x <= x1; x++, i++)
+      {
+        f(x, y, i);
+      }
+    }
   }
 };
 
@@ -29,15 +93,67 @@ Byte  0 1 ...
 template<typename Display>
 struct Staggered8BitPixelMapping
 {
+  /** \brief one line in native order is a vertical run of 8 pixels **/
+  static constexpr size_t lineLength = 8;
+
+  /** \brief line length in a buffer of the given number of columns **/
+  static size_t lineLengthOf(size_t)
+  {
+    return lineLength;
+  }
+
+  /** \brief distance in the buffer between two horizontally adjacent pixels **/
+  static constexpr size_t xStride = 8;
+
+  /** \brief a byte holds 8 rows, so pages must start at multiples of 8 rows **/
+  static constexpr size_t bankHeight = 8;
+
   static size_t map(const Point<Display>& p)
   {
-    uint8_t yOffset = p.y()%8;
-    uint8_t yBank = p.y()/8;
+    return map(p.x(), p.y());
+  }
+
+  /** \brief map plain coordinates, for bulk operations on coordinate arrays
+   * \param x column
+   * \param y row
+   * \param width number of columns in the buffer, less than the display width for column pages
+  **/
+  static size_t map(size_t x, size_t y, size_t width = Display::width)
+  {
+    size_t yOffset = y%8;
+    size_t yBank = y/8;
 
-    size_t result = 8*yBank*Display::width + 8*p.x() + yOffset;
+    size_t result = 8*yBank*width + 8*x + yOffset;
 
     return result;
   }
+
+  /** \brief visit all pixels of a rectangle in buffer order: bank by bank, and column by column within
+   * a bank
+   * \param x0 left column
+   * \param x1 right column (inclusive)
+   * \param y0 top row
+   * \param y1 bottom row (inclusive)
+   * \param f called as f(x, y, index)
+   * \param width number of columns in the buffer
+  **/
+  template <typename F>
+  static void forEach(size_t x0, size_t x1, size_t y0, size_t y1, F&& f, size_t width = Display::width)
+  {
+    for (size_t bank = y0/8; bank <= y1/8; bank++)
+    {
+      size_t yBegin = std::max(y0, 8*bank);
+      size_t yEnd = std::min(y1, 8*bank + 7);
+      for (size_t x = x0; x <= x1; x++)
+      {
+        size_t i = map(x, yBegin, width);
+        for (size_t y = yBegin; y <= yEnd; y++, i++)
+        {
+          f(x, y, i);
+        }
+      }
+    }
+  }
 };
 
 